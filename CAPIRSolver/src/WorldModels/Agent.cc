@@ -102,7 +102,7 @@ void Agent::calcShortestPath(long i, long j, long numAccessibleLocs,
 /**
  @param[out] propertiesState the property part of this agent in a state.
  */
-void Agent::getCurrState(vector<long>& propertiesState, long newX, long newY) {
+void Agent::getCurrState(PropertyVector& propertiesState, long newX, long newY) {
 	// 1. Coordinates
 	propertiesState.resize(2,0);
 	if (newX >= 0 && newY >=0){
@@ -120,8 +120,8 @@ void Agent::getCurrState(vector<long>& propertiesState, long newX, long newY) {
 
 /*************** Property Abstraction related *********/
 
-void Agent::enumerateProperties(std::vector<long>& currProperties,
-    std::vector<std::vector<long> >& output, const Agent* dealtAgent) {
+void Agent::enumerateProperties(PropertyVector& currProperties,
+    std::vector<PropertyVector>& output, const Agent* dealtAgent) {
 	// Check to see if there is any property that could be ignored
 	if (dealtAgent) {
 		output.resize(0);
@@ -138,9 +138,9 @@ void Agent::enumerateProperties(std::vector<long>& currProperties,
 }
 ;
 
-void Agent::fillProperties(std::vector<long>& absProperties,
+void Agent::fillProperties(PropertyVector& absProperties,
     long startingIndex, long endingIndex,
-    const std::vector<long>& rawProperties, Agent* dealtAgent) {
+    const PropertyVector& rawProperties, Agent* dealtAgent) {
 	for (unsigned i = startingIndex; i <= endingIndex; i++)
 		// if dealtAgent is null or it is relevant (minus startingIndex to offset x and y)
 		if ((!dealtAgent) || isRelevant(i - startingIndex, dealtAgent))
@@ -177,7 +177,7 @@ public:
     @param[out] output the array of filled properties.
     @param[in] dealtAgent used to identify properties that could be ignored when solving. Certain dealtAgent could require certain subsets of properties. This helps reduce the state space's size.
   */
-  void enumerateProperties(std::vector< long >& currProperties, std::vector< std::vector<long> >& output, const Agent* dealtAgent = 0);
+  void enumerateProperties(PropertyVector& currProperties, std::vector< PropertyVector >& output, const Agent* dealtAgent = 0);
   
   /**
     Fill in relevant properties from raw State's \a rawProperties to AbstractState's \a absProperties.
@@ -185,7 +185,7 @@ public:
     @param[in] endingIndex ending index of properties in rawProperties to be copied to absProperties.
     @param[in] dealtAgent used to identify properties that could be ignored when solving. Certain dealtAgent could require certain subsets of properties. This helps reduce the state space's size.
   */
-  void fillProperties(std::vector<long>& absProperties, long startingIndex, long endingIndex, const std::vector<long>& rawProperties, Agent* dealtAgent = 0);
+  void fillProperties(PropertyVector& absProperties, long startingIndex, long endingIndex, const PropertyVector& rawProperties, Agent* dealtAgent = 0);
   
   /**
     By default, every property is relevant when dealing with any \a dealtAgent. Certain dealtAgent could be solved without the need to enumerate certain properties. This helps reduce the state space's size.
@@ -197,7 +197,7 @@ public:
     Gets initial properties of this Agent.
     @param[out] propertiesState
   */
-  virtual void getCurrState(vector<long>& propertiesState, long newX=-1, long newY=-1);
+  virtual void getCurrState(PropertyVector& propertiesState, long newX=-1, long newY=-1);
   
   /**
     Executes this Agent's special action \a act. By default, do nothing.
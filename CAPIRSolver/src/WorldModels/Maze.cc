@@ -13,6 +13,10 @@
 
 #include "Maze.h"
 #include "MazeWorld.h"
+#include "SuccessorAccumulator.h"
+#include <sys/time.h>
+#include <pthread.h>
+#include <unistd.h>
 
 void Maze::getAbstractWorldGeometricInfo() {
 	// TO DO - Move the declaration to header and make them instance attributes.
@@ -55,8 +59,7 @@ void Maze::generateRawStateMap() {
 	std::vector<AbstractState> tempV1(0);
 	std::vector<AbstractState> tempV2(0);
 
-	reverseVAbsStateMap = new vector<AbstractState> ;
-	vAbsStateMap = new map<AbstractState, long, Utilities::AbstractStateComparator> ;
+	stateStore = new PackedStateStore;
 
 	long stateIndex;
 
@@ -64,8 +67,7 @@ void Maze::generateRawStateMap() {
 	temp.playerProperties[humanIndex].push_back(TermState);
 	temp.playerProperties[humanIndex].push_back(TermState);
 
-	reverseVAbsStateMap->push_back(temp);
-	vAbsStateMap->insert(std::pair<AbstractState, long>(temp, 0));
+	stateStore->append(temp);
 
 	// Because we are enumerating all coordinates
 	// so there's no need to enumerate monster's coord first.
@@ -130,19 +132,13 @@ void Maze::generateRawStateMap() {
 
 												specialLocation->enumerateProperties(tempV2, tempV1);
 												for (unsigned k = 0; k < tempV1.size(); k++) {
-													vAbsStateMap->insert(
-													    std::pair<AbstractState, long>(tempV1[k],
-													        stateIndex));
-													reverseVAbsStateMap->push_back(tempV1[k]);
+													stateStore->append(tempV1[k]);
 													stateIndex++;
 												}
 											} else {
 
 												for (unsigned k = 0; k < tempV2.size(); k++) {
-													vAbsStateMap->insert(
-													    std::pair<AbstractState, long>(tempV2[k],
-													        stateIndex));
-													reverseVAbsStateMap->push_back(tempV2[k]);
+													stateStore->append(tempV2[k]);
 													stateIndex++;
 												}
 											} // else
@@ -167,9 +163,7 @@ void Maze::generateRawStateMap() {
 								// 7. enumerate specialLocation's properties.
 								specialLocation->enumerateProperties(tempV1, tempV2);
 								for (unsigned k = 0; k < tempV2.size(); k++) {
-									vAbsStateMap->insert(
-									    std::pair<AbstractState, long>(tempV2[k], stateIndex));
-									reverseVAbsStateMap->push_back(tempV2[k]);
+									stateStore->append(tempV2[k]);
 									stateIndex++;
 								}
 							}
@@ -187,6 +181,9 @@ void Maze::generateRawStateMap() {
 	virtualSize = stateIndex;
 	std::cout << "Num virtual raw states: " << stateIndex << std::endl;
 
+	// 8. Index the states
+	indexStateMap();
+
 }
 ;
 
@@ -201,9 +198,7 @@ void Maze::generateAbstractStateMap() {
 	std::vector<AbstractState> tempV1(0);
 	std::vector<AbstractState> tempV2(0);
 
-	reverseVAbsStateMap = new vector<AbstractState> ;
-	vAbsStateMap = new map<AbstractState, long,
-	    Utilities::AbstractStateComparator> ;
+	stateStore = new PackedStateStore;
 
 	long stateIndex;
 
@@ -213,8 +208,7 @@ void Maze::generateAbstractStateMap() {
 		// 1. dummy terminal state, where playerProperties[humanIndex]'s first item == TermState
 
 		temp.playerProperties[humanIndex].push_back(TermState);
-		reverseVAbsStateMap->push_back(temp);
-		vAbsStateMap->insert(std::pair<AbstractState, long>(temp, 0));
+		stateStore->append(temp);
 
 		stateIndex = 1;
 
@@ -279,16 +273,12 @@ void Maze::generateAbstractStateMap() {
 
 										specialLocation->enumerateProperties(tempV2, tempV1);
 										for (unsigned k = 0; k < tempV1.size(); k++) {
-											vAbsStateMap->insert(
-											    std::pair<AbstractState, long>(tempV1[k], stateIndex));
-											reverseVAbsStateMap->push_back(tempV1[k]);
+											stateStore->append(tempV1[k]);
 											stateIndex++;
 										}
 									} else {
 										for (unsigned k = 0; k < tempV2.size(); k++) {
-											vAbsStateMap->insert(
-											    std::pair<AbstractState, long>(tempV2[k], stateIndex));
-											reverseVAbsStateMap->push_back(tempV2[k]);
+											stateStore->append(tempV2[k]);
 											stateIndex++;
 										}
 									} // else
@@ -310,8 +300,7 @@ void Maze::generateAbstractStateMap() {
 		// 1. dummy terminal state, where playerProperties[humanIndex]'s first item == TermState
 
 		temp.playerProperties[humanIndex].push_back(TermState);
-		reverseVAbsStateMap->push_back(temp);
-		vAbsStateMap->insert(std::pair<AbstractState, long>(temp, 0));
+		stateStore->append(temp);
 
 		stateIndex = 1;
 
@@ -355,9 +344,7 @@ void Maze::generateAbstractStateMap() {
 				// 7. enumerate specialLocation's properties.
 				specialLocation->enumerateProperties(tempV1, tempV2);
 				for (unsigned k = 0; k < tempV2.size(); k++) {
-					vAbsStateMap->insert(
-					    std::pair<AbstractState, long>(tempV2[k], stateIndex));
-					reverseVAbsStateMap->push_back(tempV2[k]);
+					stateStore->append(tempV2[k]);
 					stateIndex++;
 				}
 
@@ -371,6 +358,122 @@ void Maze::generateAbstractStateMap() {
 	virtualSize = stateIndex;
 	std::cout << "Num virtual abstract states: " << stateIndex << std::endl;
 
+	indexStateMap();
+
+}
+;
+
+void Maze::indexStateMap() {
+	// Raw states are indexed by their cells and properties; the store's own lookup table
+	// is only built if the states do not fit that layout
+	stateStore->compact();
+	if (!useAbstract) {
+		rawStateIndexer = new RawStateIndexer;
+		if (rawStateIndexer->build(*stateStore, gridNodeLabel, numAccessibleLocs))
+			std::cout << "Raw state index: " << rawStateIndexer->memoryUsage() / 1024
+			    << " KB" << std::endl;
+		else {
+			delete rawStateIndexer;
+			rawStateIndexer = 0;
+		}
+	}
+	if (!rawStateIndexer)
+		stateStore->buildIndex();
+	std::cout << "State store: " << stateStore->keyWords() << " word keys, "
+	    << stateStore->memoryUsage() / 1024 << " KB" << std::endl;
+}
+;
+
+void Maze::useStateMap(PackedStateStore* states) {
+	// the abstract dynamics look regions up in the visibility table
+	if (useAbstract)
+		constructVisibleNearbyRegion();
+
+	stateStore = states;
+	virtualSize = stateStore->size();
+	indexStateMap();
+}
+;
+
+void Maze::pruneUnreachableStates(const std::vector<long>& seeds) {
+	std::cout << "prune unreachable states~~~~~~~~~~" << worldTypeStr << "~~~~~"
+	    << std::endl;
+	long numHumanActs = player[0]->getNumActs();
+	long numAiActs = player[1]->getNumActs();
+
+	// 1. Breadth-first search over the same half-steps the model is built from
+	std::vector<char> reached(virtualSize, 0);
+	std::vector<long> frontier;
+	sparseStateBelief tranProb;
+	ScratchArena arena;
+	ScratchArena::Scope arenaScope(arena);
+
+	reached[longTermState] = 1;
+	frontier.push_back(longTermState);
+	for (unsigned s = 0; s < seeds.size(); s++) {
+		if ((seeds[s] >= 0) && !reached[seeds[s]]) {
+			reached[seeds[s]] = 1;
+			frontier.push_back(seeds[s]);
+		}
+	}
+
+	for (unsigned head = 0; head < frontier.size(); head++) {
+		long j = frontier[head];
+		for (long humanAct = 0; humanAct < numHumanActs; humanAct++) {
+			arena.reset();
+			HumanHalfStep step;
+			absHumanHalfStep(j, humanAct, step);
+			for (long aiAct = 0; aiAct < numAiActs; aiAct++) {
+				absAssistantHalfStep(step, aiAct, tranProb);
+				for (unsigned k = 0; k < tranProb.size(); k++) {
+					long next = tranProb[k].first;
+					if ((next >= 0) && !reached[next]) {
+						reached[next] = 1;
+						frontier.push_back(next);
+					}
+				}
+			}
+		}
+	}
+
+	std::cout << "Reachable states: " << frontier.size() << " of " << virtualSize
+	    << " (" << (100.0 * frontier.size() / virtualSize) << "%)" << std::endl;
+
+	keepStates(reached);
+}
+;
+
+void Maze::keepStates(const std::vector<char>& keep) {
+	if (rawStateIndexer) {
+		std::vector<long> newIndex(virtualSize, -1);
+		long kept = 0;
+		for (long j = 0; j < virtualSize; j++)
+			if (keep[j])
+				newIndex[j] = kept++;
+		rawStateIndexer->renumber(newIndex);
+	}
+	stateStore->keep(keep);
+	virtualSize = stateStore->size();
+}
+;
+
+void Maze::generateLazyStateMap() {
+	std::cout << "generate lazy stateMap~~~~~~~~~~" << worldTypeStr << "~~~~~"
+	    << std::endl;
+	// the abstract dynamics look regions up in the visibility table
+	if (useAbstract)
+		constructVisibleNearbyRegion();
+
+	// dummy terminal state, where playerProperties[humanIndex]'s first item == TermState
+	AbstractState temp;
+	temp.playerProperties[humanIndex].push_back(TermState);
+	if (!useAbstract)
+		temp.playerProperties[humanIndex].push_back(TermState);
+
+	stateStore = new PackedStateStore;
+	stateStore->insert(temp);
+	lazyIndex = true;
+	virtualSize = 1;
 }
 ;
 
@@ -687,31 +790,117 @@ void Maze::generateModel() {
 
 	// 2a. Declaration
 	// Q: What are the dimensions of transitionMatrices and rewardMatrices?
-	// A: transitionMatrix = 3, currStateIndex, compoundAct, (nextStateIndex, probability)
-	// rewardMatrix = 2, currStateIndex, compoundAct
+	// A: transitionMatrix is a CSR table, row = currStateIndex * numActs + compoundAct,
+	// entries (nextStateIndex, probability)
+	// rewards live in the same rows, one per (currStateIndex, compoundAct)
 	// We no long need to maintain transitionMatrices
 	// Remove dimension worldIndex from these two matrices, resize them at the start of each
 	// iteration
-	std::vector<std::vector<std::vector<pair<long, double> > > > transitionMatrix;
-	std::vector<std::vector<double> > rewardMatrix;
+	// With a scratch directory the transition model and its rewards live in files there and
+	// are mapped for the sweeps; only the value vectors stay in memory. The pid keeps runs
+	// sharing the directory off each other's files.
+	std::string transFilePrefix;
+	if (!mazeWorld->scratchDir.empty()) {
+		std::stringstream prefix;
+		prefix << mazeWorld->scratchDir << "/capir-" << getpid() << "-" << worldTypeStr;
+		transFilePrefix = prefix.str();
+	}
+	SparseTransitionModel transitionMatrix(virtualSize, numActs, transFilePrefix);
 
 	ValueIteration* viSolver;
 
-	// 1. allocate memory
-	valueFn = new vector<double> (0);
-	collabQFn = new vector<vector<double> > (0);
+	// 1. allocate memory. valueFn is only needed when Q is built in a separate pass
+	valueFn = 0;
+	collabQFn = new vector<vector<QValue> > (0);
 
 	// 2. Construct transition matrices and reward matrices
-	constructTRCompAct(transitionMatrix, rewardMatrix);
+	constructTRCompAct(transitionMatrix);
 	std::cout << "Now solve~~~~~~~~~" << std::endl;
+	vector<QValue> initValues;
+	if (!mazeWorld->warmStartFile.empty())
+		readWarmStartValues(initValues);
+
+	struct timeval solveStart, solveEnd;
+	gettimeofday(&solveStart, NULL);
+
+	if (mazeWorld->evalSweeps > 0) {
+		// 3'. Modified policy iteration instead of value iteration
+		ModifiedPolicyIteration piSolver(virtualSize, numActs, mazeWorld->discount,
+		    mazeWorld->evalSweeps);
+		piSolver.setInitialValues(initValues);
+		piSolver.doPolicyIteration(transitionMatrix,
+		    mazeWorld->targetPrecision, mazeWorld->displayInterval);
+		gettimeofday(&solveEnd, NULL);
+		std::cout << "Converged after " << piSolver.numSweeps << " improvements, "
+		    << piSolver.numBackups << " backups, " << piSolver.numEvalBackups
+		    << " evaluation backups, "
+		    << Utilities::getMilsecDiff(solveStart, solveEnd) << " ms" << std::endl;
+
+		valueFn = new vector<QValue> (0);
+		valueFn->swap(piSolver.values);
+		constructCollabQFns(transitionMatrix);
+		delete valueFn;
+		valueFn = 0;
+		return;
+	}
+
 	// 3. Use resulted rewardMatrices and transitionMatrices to run ValueIteration for valueFns
 	viSolver = new ValueIteration(virtualSize, numActs, mazeWorld->discount);
+	viSolver->setNumThreads(mazeWorld->numThreads);
+	viSolver->setNumProcesses(mazeWorld->numProcesses);
+	viSolver->setInitialValues(initValues);
+	if (mazeWorld->actionElimination) {
+		// One-step rewards are bounded by the maze's own reward range, widened by what
+		// the dynamics actually produced; V* then lies within those bounds / (1 - discount)
+		double rMax = getMaxReward(), rMin = getMinReward();
+		for (long j = 0; j < virtualSize; j++)
+			for (long compAct = 0; compAct < numActs; compAct++) {
+				if (transitionMatrix.reward(j, compAct) > rMax)
+					rMax = transitionMatrix.reward(j, compAct);
+				if (transitionMatrix.reward(j, compAct) < rMin)
+					rMin = transitionMatrix.reward(j, compAct);
+			}
+		if (rMin > 0)
+			rMin = 0;
+		if (rMax < 0)
+			rMax = 0;
+		viSolver->setActionElimination(true, rMin / (1 - mazeWorld->discount),
+		    rMax / (1 - mazeWorld->discount));
+	}
+	viSolver->setSweepType(mazeWorld->sweepType, mazeWorld->stateOrder, longTermState);
+	const char* kernelName;
+	viSolver->setBackupKernel(BellmanBackup::selectKernel(numActs,
+	    BellmanBackup::detectISA(), &kernelName));
+	std::cout << "Backup kernel: " << kernelName << std::endl;
+	// Unless actions are being eliminated, every sweep writes the Q rows it computes
+	// straight into collabQFn, so the last sweep leaves the Q function behind. Out of
+	// core, the Q rows would sit in memory next to the value vectors for the whole solve:
+	// they are rebuilt afterwards instead, in one pass over the mapped model.
+	bool fusedQ = !mazeWorld->actionElimination && !transitionMatrix.isOutOfCore();
+	if (fusedQ) {
+		collabQFn->resize(virtualSize);
+		for (long j = 0; j < virtualSize; j++)
+			(*collabQFn)[j].resize(numActs);
+		viSolver->setQOutput(collabQFn);
+	}
 	// targetPrecision = 0.01, displayInterval = 60
-	viSolver -> doValueIteration(rewardMatrix, transitionMatrix,
+	viSolver -> doValueIteration(transitionMatrix,
 	    mazeWorld->targetPrecision, mazeWorld->displayInterval);
+	gettimeofday(&solveEnd, NULL);
+	std::cout << "Converged after " << viSolver->numSweeps << " sweeps, "
+	    << viSolver->numBackups << " backups, " << viSolver->numActionEvals
+	    << " action evaluations, "
+	    << Utilities::getMilsecDiff(solveStart, solveEnd) << " ms" << std::endl;
+
+	if (fusedQ) {
+		// 4'. collabQFn is complete: release the model right away
+		delete viSolver;
+		transitionMatrix.clear();
+		return;
+	}
 
 	// 4. Now viSolver stores the values, push it to valueFns
-	// valueFn = new std::vector<double>;
+	valueFn = new std::vector<QValue>;
 
 	for (unsigned j = 0; j < viSolver->values.size(); j++)
 		valueFn->push_back(viSolver->values[j]);
@@ -721,20 +910,169 @@ void Maze::generateModel() {
 	// 5. compute virtual Q Functions for compound actions first
 
 	// use valueFn
-	constructCollabQFns(transitionMatrix, rewardMatrix);
+	constructCollabQFns(transitionMatrix);
+	delete valueFn;
+	valueFn = 0;
+
+}
+;
+
+/**
+ LRTDP's view of a lazily indexed maze.
+ */
+class MazeLRTDPModel: public LRTDP::Model {
+public:
+	MazeLRTDPModel(Maze* maze) :
+		maze(maze) {
+	}
+	;
+	void expand(long state, std::vector<QValue>& rewards,
+	    std::vector<sparseStateBelief>& next) {
+		maze->expandState(state, rewards, next);
+	}
+	;
+	bool isTerminal(long state) {
+		// every terminal AbstractState is indexed as longTermState
+		return state == longTermState;
+	}
+	;
+private:
+	Maze* maze;
+};
+
+void Maze::expandState(long state, std::vector<QValue>& rewards,
+    std::vector<sparseStateBelief>& next) {
+	long numHumanActs = player[0]->getNumActs();
+	long numAiActs = player[1]->getNumActs();
+	ScratchArena arena;
+	ScratchArena::Scope arenaScope(arena);
+
+	rewards.resize(numHumanActs * numAiActs);
+	next.resize(numHumanActs * numAiActs);
+	for (long humanAct = 0; humanAct < numHumanActs; humanAct++) {
+		arena.reset();
+		HumanHalfStep step;
+		absHumanHalfStep(state, humanAct, step);
+		for (long aiAct = 0; aiAct < numAiActs; aiAct++)
+			rewards[humanAct * numAiActs + aiAct] = absAssistantHalfStep(step, aiAct,
+			    next[humanAct * numAiActs + aiAct]);
+	}
+}
+;
+
+/**
+ Seed of the successors sampled by the LRTDP trials, so a run is reproducible.
+ */
+const unsigned LRTDPSeed = 1;
+
+void Maze::solveLRTDP(const std::vector<long>& seeds) {
+	std::cout << "solveLRTDP~~~~~" << worldTypeStr << "~~~~~" << std::endl;
+	long numActs = player[0]->getNumActs() * player[1]->getNumActs();
+
+	std::vector<long> starts;
+	for (unsigned s = 0; s < seeds.size(); s++)
+		if (seeds[s] >= 0)
+			starts.push_back(seeds[s]);
+
+	// 1. Rewards only come with a terminal outcome, at most once, so no value exceeds the
+	// largest of them: starting every value there keeps LRTDP optimistic
+	MazeLRTDPModel model(this);
+	RandSource::init(LRTDPSeed);
+	RandSource randSource(1);
+	LRTDP solver(model, randSource, numActs, mazeWorld->discount,
+	    getMaxReward() + HumanRewardBias);
+
+	struct timeval solveStart, solveEnd;
+	gettimeofday(&solveStart, NULL);
+	solver.solve(starts, mazeWorld->targetPrecision, mazeWorld->lrtdpTrials,
+	    mazeWorld->displayInterval);
+	gettimeofday(&solveEnd, NULL);
+	std::cout << (solver.converged ? "Start states solved after " : "Stopped after ")
+	    << solver.numTrials << " trials, " << solver.numBackups << " backups, "
+	    << solver.numExpanded << " states expanded of " << virtualSize << " seen, "
+	    << Utilities::getMilsecDiff(solveStart, solveEnd) << " ms" << std::endl;
+
+	// 2. Keep Q rows, and states, only for what was expanded; the terminal state's row is 0
+	std::vector<char> keep(virtualSize, 0);
+	keep[longTermState] = 1;
+	for (long j = 0; j < virtualSize; j++)
+		if (solver.isExpanded(j))
+			keep[j] = 1;
+
+	valueFn = 0;
+	collabQFn = new vector<vector<QValue> > (0);
+	for (long j = 0; j < virtualSize; j++) {
+		if (!keep[j])
+			continue;
+		collabQFn->push_back(vector<QValue> (numActs, 0));
+		if (solver.isExpanded(j))
+			solver.getQValues(j, collabQFn->back());
+	}
+	keepStates(keep);
+}
+;
+
+/**
+ Arguments handed to each model construction thread.
+ */
+struct ConstructTask {
+	Maze* maze;
+	long begin, end;
+	sparseStateBelief entries;
+	std::vector<long> rowEnds;
+	std::vector<QValue> rewards;
+};
+
+/**
+ States each construction thread takes per round. Rows are buffered until the round's
+ ranges are appended in order, so this bounds the buffers.
+ */
+const long ConstructBlockSize = 512;
 
+void* Maze::constructTRWorker(void* arg) {
+	ConstructTask* task = (ConstructTask*) arg;
+	task->maze->constructTRRange(task->begin, task->end, task->entries,
+	    task->rowEnds, task->rewards);
+	return NULL;
+}
+;
+
+void Maze::constructTRRange(long begin, long end, sparseStateBelief& entries,
+    std::vector<long>& rowEnds, std::vector<QValue>& rewards) {
+	long numHumanActs = player[0]->getNumActs();
+	long numAiActs = player[1]->getNumActs();
+	sparseStateBelief tranProb;
+	ScratchArena arena;
+	ScratchArena::Scope arenaScope(arena);
+
+	entries.resize(0);
+	rowEnds.resize(0);
+	rewards.resize(0);
+	for (long j = begin; j < end; j++) {
+		for (long humanAct = 0; humanAct < numHumanActs; humanAct++) {
+			// the half-step's scratch lives until its fan-out is done
+			arena.reset();
+			HumanHalfStep step;
+			absHumanHalfStep(j, humanAct, step);
+			for (long aiAct = 0; aiAct < numAiActs; aiAct++) {
+				rewards.push_back(absAssistantHalfStep(step, aiAct, tranProb));
+				entries.insert(entries.end(), tranProb.begin(), tranProb.end());
+				rowEnds.push_back(entries.size());
+			}
+		}
+	}
 }
 ;
 
 void Maze::constructTRCompAct(
-    std::vector<std::vector<std::vector<std::pair<long, double> > > >& transitionMatrix,
-    std::vector<std::vector<double> >& rewardMatrix) {
+    SparseTransitionModel& transitionMatrix) {
 	std::cout << "constructTRCompAct~~~~~" << worldTypeStr << "~~~~~"
 	    << std::endl;
 	// Conversion: compoundAct = humanAct * numAiActs + aiAct
 	// humanAct = compoundAct / numAiActs
 	// aiAct = compoundAct % numAiActs
-	long numActs = player[0]->getNumActs() * player[1]->getNumActs();
+	long numHumanActs = player[0]->getNumActs();
+	long numAiActs = player[1]->getNumActs();
 
 	// Assumptions:
 	// 1. HumanActs are 0...(numHumanActs-1)
@@ -743,33 +1081,78 @@ void Maze::constructTRCompAct(
 
 	sparseStateBelief tranProb;
 
-	transitionMatrix.resize(virtualSize);
-	rewardMatrix.resize(virtualSize);
-
-	// 2a. Use virtualDynamics to populate rewardMatrices and transitionMatrices
-	for (long j = 0; j < virtualSize; j++) {
-		// j is current state in virtualWorld i
-		// std::cout << j<<".." << std::endl;
-		transitionMatrix[j].resize(0);
-		rewardMatrix[j].resize(numActs);
+	long numThreads = mazeWorld->numThreads;
+	if (numThreads <= 1) {
+		// 2a. Use the dynamics to populate rewardMatrices and transitionMatrices. The human's
+		// half of the step only depends on (j, humanAct), so it is computed once and
+		// fanned out over the assistant's actions; rows stay in compoundAct order.
+		// Scratch beliefs come from the arena, which is rewound after each fan-out.
+		ScratchArena arena;
+		ScratchArena::Scope arenaScope(arena);
+		for (long j = 0; j < virtualSize; j++) {
+			// j is current state in virtualWorld i
+			for (long humanAct = 0; humanAct < numHumanActs; humanAct++) {
+				arena.reset();
+				HumanHalfStep step;
+				absHumanHalfStep(j, humanAct, step);
+				for (long aiAct = 0; aiAct < numAiActs; aiAct++) {
+					double reward = absAssistantHalfStep(step, aiAct, tranProb);
+					// transitionMatrices
+					transitionMatrix.addRow(tranProb, reward);
+				}
+			} // for long humanAct
 
-		for (long compAct = 0; compAct < numActs; compAct++) {
-			rewardMatrix[j][compAct] = absVirtualDynamics(j,
-			    compAct / player[1]->getNumActs(), compAct % player[1]->getNumActs(),
-			    tranProb);
-			// transitionMatrices
-			transitionMatrix[j].push_back(tranProb);
+		} // for long j
+	} else {
+		// 2a'. Each round, every thread builds a block of consecutive states into its own
+		// buffers; the blocks are then appended in state order, so the model is the
+		// same as the serial one.
+		std::vector<ConstructTask> tasks(numThreads);
+		std::vector<pthread_t> threads(numThreads);
+		for (long t = 0; t < numThreads; t++) {
+			tasks[t].maze = this;
+		}
 
-		} // for long compAct
+		for (long base = 0; base < virtualSize; base += numThreads
+		    * ConstructBlockSize) {
+			for (long t = 0; t < numThreads; t++) {
+				tasks[t].begin = getMin(base + t * ConstructBlockSize, virtualSize);
+				tasks[t].end = getMin(tasks[t].begin + ConstructBlockSize, virtualSize);
+			}
+			// block 0 is built by the calling thread
+			for (long t = 1; t < numThreads; t++) {
+				if (pthread_create(&threads[t], NULL, constructTRWorker, &tasks[t])
+				    != 0) {
+					std::cerr << "Fail to create construction thread " << t << "\n";
+					exit(EXIT_FAILURE);
+				}
+			}
+			constructTRWorker(&tasks[0]);
+			for (long t = 1; t < numThreads; t++)
+				pthread_join(threads[t], NULL);
+
+			for (long t = 0; t < numThreads; t++) {
+				long rowBegin = 0;
+				for (unsigned r = 0; r < tasks[t].rowEnds.size(); r++) {
+					tranProb.assign(tasks[t].entries.begin() + rowBegin,
+					    tasks[t].entries.begin() + tasks[t].rowEnds[r]);
+					transitionMatrix.addRow(tranProb, tasks[t].rewards[r]);
+					rowBegin = tasks[t].rowEnds[r];
+				}
+			}
+		}
+	}
 
-	} // for long j
+	transitionMatrix.shrinkToFit();
+	std::cout << "Transition entries: " << transitionMatrix.getNumEntries() << " ("
+	    << transitionMatrix.memoryUsage() / 1024 << " KB"
+	    << (transitionMatrix.isOutOfCore()? " in memory, rest mapped from disk)" : ")") << std::endl;
 
 }
 ;
 
 void Maze::constructCollabQFns(
-    std::vector<std::vector<std::vector<pair<long, double> > > >& transitionMatrix,
-    std::vector<std::vector<double> >& rewardMatrix) {
+    SparseTransitionModel& transitionMatrix) {
 
 	long numActs = player[0]->getNumActs() * player[1]->getNumActs();
 
@@ -790,13 +1173,13 @@ void Maze::constructCollabQFns(
 
 		for (long compAct = 0; compAct < numActs; compAct++) {
 			double sumValue = 0;
-			for (long k = 0; k < (long) transitionMatrix[j][compAct].size(); k++) {
-				sumValue += transitionMatrix[j][compAct][k].second
-				    * (*valueFn)[transitionMatrix[j][compAct][k].first];
+			for (long k = transitionMatrix.rowBegin(j, compAct); k < transitionMatrix.rowEnd(j, compAct); k++) {
+				sumValue += (double) transitionMatrix.probs[k]
+				    * (*valueFn)[transitionMatrix.nextStates[k]];
 			}
 
 			// virtualQFn[j][compAct] = rewardMatrix[j][compAct] + mazeWorld->discount * sumValue;
-			(*collabQFn)[j][compAct] = rewardMatrix[j][compAct] + mazeWorld->discount
+			(*collabQFn)[j][compAct] = transitionMatrix.reward(j, compAct) + mazeWorld->discount
 			    * sumValue;
 
 #ifdef DEBUG      
@@ -808,6 +1191,44 @@ void Maze::constructCollabQFns(
 
 }
 ;
+bool Maze::readWarmStartValues(vector<QValue>& initValues) {
+	long numActs = player[0]->getNumActs() * player[1]->getNumActs();
+	std::string filename = MazeWorld::solutionFilename(mazeWorld->warmStartFile, this);
+	vector<vector<QValue> > oldQFn;
+	long oldSize;
+
+	initValues.resize(0);
+	if (!MazeWorld::readQFunction(filename, numActs, oldSize, oldQFn)) {
+		std::cout << "Cold start: cannot open " << filename << std::endl;
+		return false;
+	}
+	if (oldSize != virtualSize) {
+		std::cout << "Cold start: " << filename << " has " << oldSize
+		    << " states, state map now has " << virtualSize << std::endl;
+		return false;
+	}
+
+	initValues.resize(virtualSize);
+	for (long j = 0; j < virtualSize; j++)
+		initValues[j] = Distribution::getMaxValue(oldQFn[j]);
+
+	std::cout << "Warm start from " << filename << std::endl;
+	return true;
+}
+;
+
+void Maze::quantizeQFn() {
+	if (quantQFn || !collabQFn)
+		return;
+	quantQFn = new QuantizedQTable;
+	quantQFn->quantize(*collabQFn, player[0]->getNumActs() * player[1]->getNumActs());
+	delete collabQFn;
+	collabQFn = 0;
+	std::cout << "Quantized Q function: " << quantQFn->memoryUsage() / 1024 << " KB"
+			<< std::endl;
+}
+;
+
 // TODO --------------- virtualDynamics related
 /************************** virtualDynamics related *******************/
 
@@ -820,52 +1241,66 @@ void Maze::constructCollabQFns(
  */
 double Maze::absVirtualDynamics(const long currAbsState, const long hAct,
     const long aAct, sparseStateBelief& tranProb) {
-	if (currAbsState == longTermState) { // TermState
-		tranProb.resize(0);
-		std::pair<long, double> prob(longTermState, 1);
-		tranProb.push_back(prob);
-		return 0;
-	}
+	HumanHalfStep step;
+	absHumanHalfStep(currAbsState, hAct, step);
+	return absAssistantHalfStep(step, aAct, tranProb);
+}
+;
 
-	long humanAct = hAct;
-	long aiAct = aAct;
+void Maze::absHumanHalfStep(const long currAbsState, const long hAct,
+    HumanHalfStep& step) {
+	step.outcome.resize(0);
+	step.terminal = (currAbsState == longTermState); // TermState
+	if (step.terminal)
+		return;
 
-	// 1. Get region's id of human, agent and monster, and their relative positions as well as visibility of human and agent
-	AbstractState absState = (*reverseVAbsStateMap)[currAbsState];
-	// getAbsStateFromLong(currAbsState);
+	step.humanAct = hAct;
 
-	// This IS meaningful, considering the fact that reverseVAbsStateMap stores all absState. Same as when encountering TermState
-	if (isAbstractTerminal(absState)) {
-		tranProb.resize(0);
-		std::pair<long, double> prob(longTermState, 1);
-		tranProb.push_back(prob);
-		return 0;
-	}
-
-	double reward = 0;
-	long tempAbsState;
+	// 1. Get region's id of human, agent and monster, and their relative positions as well as visibility of human and agent
+	stateStore->get(currAbsState, step.prevAbsState);
 
-	AbstractState prevAbsState;
-	Utilities::cloneAbsState(absState, prevAbsState);
+	// This IS meaningful, considering the fact that stateStore stores all absState. Same as when encountering TermState
+	step.terminal = isAbstractTerminal(step.prevAbsState);
+	if (step.terminal)
+		return;
 
 	// stores the belief of next states
-	std::vector<std::pair<AbstractState, double> > temp1, temp2, temp3, temp4;
+	abstractStateBelief temp1;
 
 	// 2. Execute human's action
-	temp1.push_back(std::pair<AbstractState, double>(absState, 1));
+	temp1.push_back(std::pair<AbstractState, double>(step.prevAbsState, 1));
 	// 1. If this is a move act, move and update visibility
-	if (player[0]->isMoveAct(humanAct)) {
+	if (player[0]->isMoveAct(step.humanAct)) {
 		// humanAct can be set to unchanged in absExecuteAgentMoveAct
-		absExecuteAgentMoveAct(temp1, humanAct, humanIndex, temp2);
+		absExecuteAgentMoveAct(temp1, step.humanAct, humanIndex, step.outcome);
 	}
 	// 2. Otherwise, this is a special act
-	else if (player[0]->isSpecialAct(humanAct)) {
-		player[0]->absExecuteSpecialAct(temp1, humanAct, temp2);
+	else if (player[0]->isSpecialAct(step.humanAct)) {
+		player[0]->absExecuteSpecialAct(temp1, step.humanAct, step.outcome);
 	}
 	// 3. Unsupported action
 	else {
-		Utilities::copyAbstractProbArray(temp1, temp2);
+		Utilities::copyAbstractProbArray(temp1, step.outcome);
 	}
+}
+;
+
+double Maze::absAssistantHalfStep(const HumanHalfStep& step, const long aAct,
+    sparseStateBelief& tranProb) {
+	if (step.terminal) {
+		tranProb.resize(0);
+		std::pair<long, double> prob(longTermState, 1);
+		tranProb.push_back(prob);
+		return 0;
+	}
+
+	long humanAct = step.humanAct;
+	long aiAct = aAct;
+	double reward = 0;
+	SuccessorAccumulator successors;
+
+	// the move routines update their input in place, so work on a copy of the human's outcome
+	abstractStateBelief temp2(step.outcome), temp3, temp4;
 
 	// 3. Execute assistant's action
 	if (player[1]->isMoveAct(aiAct)) {
@@ -881,7 +1316,7 @@ double Maze::absVirtualDynamics(const long currAbsState, const long hAct,
 	}
 
 	// 4. Move the maze's entities (monster and update specialLocation's properties).
-	absExecuteMazeDynamics(temp3, humanAct, aiAct, temp4, prevAbsState);
+	absExecuteMazeDynamics(temp3, humanAct, aiAct, temp4, step.prevAbsState);
 
 	// 5. Quantify the rewards
 	std::vector<double> rewards;
@@ -889,24 +1324,23 @@ double Maze::absVirtualDynamics(const long currAbsState, const long hAct,
 	// This routine judges the outcomes and put rewards on them.
 	absGetRewards(temp4, rewards);
 
-	// 6. temp4 now stores all next states and probability. Now convert them to long and normalize the probability
-	tranProb.resize(0);
+	// 6. temp4 now stores all next states and probability. Now convert them to long and
+	// merge those that map to the same index, so each row lists a next state once
 	for (unsigned i = 0; i < temp4.size(); i++) {
 		reward += rewards[i];
-
-		tempAbsState = getLongFromAbsState(temp4[i].first);
-		Utilities::addLongAbsStateToVector(tempAbsState, temp4[i].second, tranProb);
+		successors.add(getLongFromAbsState(temp4[i].first), temp4[i].second);
 	}
+	successors.copyTo(tranProb);
 
 	return reward;
 }
 ;
 
 void Maze::absExecuteMazeDynamics(
-    std::vector<std::pair<AbstractState, double> >& input, long humanAct,
-    long aiAct, std::vector<std::pair<AbstractState, double> >& output,
+    abstractStateBelief& input, long humanAct,
+    long aiAct, abstractStateBelief& output,
     const AbstractState& prevAbsState) {
-	std::vector<std::pair<AbstractState, double> > tempOutput(0);
+	abstractStateBelief tempOutput(0);
 
 	if (monster) {
 		monster->absReact(input, humanAct, aiAct, tempOutput, prevAbsState);
@@ -936,7 +1370,7 @@ bool Maze::monsterPassable(long mx, long my, long p1x, long p1y, long p2x,
 
 void Maze::absExecuteMonsterMoveAct(AbstractState& currAbsState, double prob,
     long humanAct, long aiAct, long act, double probAct,
-    std::vector<std::pair<AbstractState, double> >& output,
+    abstractStateBelief& output,
     const AbstractState& prevAbsState) {
 
 	AbstractState nextAbsState;
@@ -947,7 +1381,7 @@ void Maze::absExecuteMonsterMoveAct(AbstractState& currAbsState, double prob,
 	bool terminal;
 	int x = 1, y = 2;
 
-	std::vector<std::pair<AbstractState, double> > tempOutput;
+	abstractStateBelief tempOutput;
 	// std::vector< double > tempRewards;
 
 	nextAbsState = currAbsState;
@@ -981,9 +1415,11 @@ void Maze::absExecuteMonsterMoveAct(AbstractState& currAbsState, double prob,
 
 				if (!isAbstractTerminal(nextAbsState))
 					Utilities::addAbsStateToVector(nextAbsState, prob * probAct, output);
-				else
-					Utilities::addAbsStateToVector((*reverseVAbsStateMap)[0],
-					    prob * probAct, output);
+				else {
+					AbstractState terminal;
+					stateStore->get(longTermState, terminal);
+					Utilities::addAbsStateToVector(terminal, prob * probAct, output);
+				}
 			}
 			return;
 		}
@@ -1049,8 +1485,9 @@ void Maze::absExecuteMonsterMoveAct(AbstractState& currAbsState, double prob,
 					Utilities::addAbsStateToVector(tempOutput[j].first,
 					    probNext * tempOutput[j].second, output);
 			} else {
-				Utilities::addAbsStateToVector((*reverseVAbsStateMap)[0], probNext,
-				    output);
+				AbstractState terminal;
+				stateStore->get(longTermState, terminal);
+				Utilities::addAbsStateToVector(terminal, probNext, output);
 			}
 		}
 
@@ -1060,8 +1497,8 @@ void Maze::absExecuteMonsterMoveAct(AbstractState& currAbsState, double prob,
 ;
 
 void Maze::absExecuteAgentMoveAct(
-    std::vector<std::pair<AbstractState, double> >& input, long& action,
-    int agentIndex, std::vector<std::pair<AbstractState, double> >& output) {
+    abstractStateBelief& input, long& action,
+    int agentIndex, abstractStateBelief& output) {
 	assert( (!input.empty()) );
 
 	if (monster) {
@@ -1075,8 +1512,8 @@ void Maze::absExecuteAgentMoveAct(
 ;
 
 void Maze::executeAgentMoveAct_gotMonster(
-    std::vector<std::pair<AbstractState, double> >& input, long &action,
-    int agentIndex, std::vector<std::pair<AbstractState, double> >& output) {
+    abstractStateBelief& input, long &action,
+    int agentIndex, abstractStateBelief& output) {
 	output.resize(0);
 	// AbstractState currAbsState, nextAbsState;
 
@@ -1094,11 +1531,11 @@ void Maze::executeAgentMoveAct_gotMonster(
 			continue;
 		}
 
-		long &currAgentX = input[i].first.playerProperties[agentIndex][x];
-		long &currAgentY = input[i].first.playerProperties[agentIndex][y];
+		PropertyValue &currAgentX = input[i].first.playerProperties[agentIndex][x];
+		PropertyValue &currAgentY = input[i].first.playerProperties[agentIndex][y];
 
-		long &otherAgentX = input[i].first.playerProperties[1 - agentIndex][x];
-		long &otherAgentY = input[i].first.playerProperties[1 - agentIndex][y];
+		PropertyValue &otherAgentX = input[i].first.playerProperties[1 - agentIndex][x];
+		PropertyValue &otherAgentY = input[i].first.playerProperties[1 - agentIndex][y];
 
 		// Agent movement ------------------------------
 		// tempX, tempY are always >=0 and <= sizeX, sizeY because the boundary of grid is always wall
@@ -1162,8 +1599,8 @@ bool Maze::isValidMove(int agentIndex, long tempX, long tempY,
  agentIndex == humanIndex -> human
  */
 void Maze::absExecuteAgentMoveAct_gotMonster(
-    std::vector<std::pair<AbstractState, double> >& input, long &action,
-    int agentIndex, std::vector<std::pair<AbstractState, double> >& output) {
+    abstractStateBelief& input, long &action,
+    int agentIndex, abstractStateBelief& output) {
 	// 2. Declaration
 	output.resize(0);
 	AbstractState currAbsState, nextAbsState;
@@ -1525,7 +1962,7 @@ void Maze::absExecuteAgentMoveAct_gotMonster(
  The rewards in rewards are already multiplied by the probabilities of the states.
  */
 void Maze::absGetRewards(
-    std::vector<std::pair<AbstractState, double> >& states,
+    abstractStateBelief& states,
     std::vector<double>& rewards) {
 	rewards.resize(0);
 	double reward, tempR;
@@ -1559,7 +1996,7 @@ void Maze::absGetRewards(
 /**************** Visibility related ************************************/
 
 void Maze::updateVisibility(AbstractState& absState,
-    std::vector<std::pair<AbstractState, double> >& output, long humanAct,
+    abstractStateBelief& output, long humanAct,
     long aiAct, long monsterAct, long priorMonsterX, long priorMonsterY,
     const AbstractState& prevAbsState) {
 	output.resize(0);
@@ -1568,7 +2005,7 @@ void Maze::updateVisibility(AbstractState& absState,
 		return;
 	}
 
-	std::vector<std::pair<AbstractState, double> > temp;
+	abstractStateBelief temp;
 	temp.resize(0);
 
 	updateCoordsByMonsterMove(absState, monsterAct,
@@ -1592,8 +2029,8 @@ void Maze::updateVisibility(AbstractState& absState,
  Update visibility and coords of agentIndex
  */
 void Maze::updateVisibilityCoordsOneAgent(
-    std::vector<std::pair<AbstractState, double> >& input,
-    std::vector<std::pair<AbstractState, double> >& output, long monsterAct,
+    abstractStateBelief& input,
+    abstractStateBelief& output, long monsterAct,
     long priorMonsterX, long priorMonsterY, long agentAct, int agentIndex,
     const AbstractState& prevAbsState) {
 	output.resize(0);
@@ -2042,29 +2479,35 @@ bool Maze::isAbstractTerminal(const AbstractState& absState) {
 }
 ;
 
-long Maze::getLongFromAbsState(AbstractState& absState) {
+long Maze::getLongFromAbsState(const AbstractState& absState) {
 	// 1. If this is a terminal abs state, return virtualTerminalState
 	if (isAbstractTerminal(absState))
 		return longTermState; // 0
 	// Else retrieve from abstract state map its index
 	else {
 
-		// 1. standardize absState
-		if (useAbstract)
-			standardizeCoords(absState);
+		// 1. standardize a copy of absState, the caller's state is left untouched
+		AbstractState standardState;
+		if (useAbstract) {
+			standardState = absState;
+			standardizeCoords(standardState);
+		}
+		const AbstractState& key = useAbstract? standardState : absState;
+
+		if (lazyIndex) {
+			// first time this state is reached: give it the next index
+			long index = stateStore->insert(key);
+			virtualSize = stateStore->size();
+			return index;
+		}
 
-		// 2. search in abs state map
-		//long value = vAbsStateMap->find(absState)->second;
-		std::map<AbstractState, long>::iterator currStates = vAbsStateMap->find(
-		    absState);
-		if (currStates == vAbsStateMap->end()) {
+		// 2. search in the raw index, or else in the state store
+		long index = rawStateIndexer? rawStateIndexer->find(key) : stateStore->find(key);
+		if (index < 0) {
 			std::cout << "wrong absState - " << worldTypeStr << ":" << std::endl;
-			Utilities::printAbsState(absState);
+			Utilities::printAbsState(key);
 		}
-		// else if (currStates->second == 314){
-		//       std::cout << "absState 314" << std::endl;
-		//     }
-		return currStates->second;
+		return index;
 	}
 }
 ;
@@ -2118,7 +2561,7 @@ bool Maze::checkVisibility(long p1X, long p1Y, long p2X, long p2Y) {
 // TODO --------------- Raw state related
 /******************** Raw state related ************************/
 
-void Maze::getCurrState(vector<long>& propertiesState, long newX, long newY) {
+void Maze::getCurrState(PropertyVector& propertiesState, long newX, long newY) {
 
 	propertiesState.resize(0);
 
@@ -2167,9 +2610,10 @@ long Maze::getLongAbsStateFromState_NoAbs(const State& state, long worldNum) {
 
 		updateVisibility_NoAbs(absState);
 
-		// Monster's properties
+		// Monster's properties, only those the raw state map enumerates (relevant to the human)
 		monster->fillProperties(absState.monsterProperties, 2,
-		    2 + monster->getNumProperties() - 1, state.mazeProperties[worldNum]);
+		    2 + monster->getNumProperties() - 1, state.mazeProperties[worldNum],
+		    player[0]);
 		startIndexSL = monster->getNumProperties();
 	}
 
@@ -2359,11 +2803,11 @@ void Maze::deleteCommonPointers() {
 		delete visibleNearByRegions;
 	}
 
-	if (vAbsStateMap) {
-		delete vAbsStateMap;
+	if (stateStore) {
+		delete stateStore;
 	}
-	if (reverseVAbsStateMap) {
-		delete reverseVAbsStateMap;
+	if (rawStateIndexer) {
+		delete rawStateIndexer;
 	}
 
 	if (valueFn) {
@@ -2372,6 +2816,9 @@ void Maze::deleteCommonPointers() {
 	if (collabQFn) {
 		delete collabQFn;
 	}
+	if (quantQFn) {
+		delete quantQFn;
+	}
 }
 ;
 
@@ -2389,10 +2836,11 @@ Maze::~Maze() {
 	rType = 0;
 	visibleNearByRegions = 0;
 
-	vAbsStateMap = 0;
-	reverseVAbsStateMap = 0;
+	stateStore = 0;
+	rawStateIndexer = 0;
 	valueFn = 0;
 	collabQFn = 0;
+	quantQFn = 0;
 
 	if (monster) {
 		delete monster;
@@ -19,6 +19,11 @@
 #include "Monster.h"
 #include "SpecialLocation.h"
 #include "ValueIteration.h"
+#include "ModifiedPolicyIteration.h"
+#include "RawStateIndexer.h"
+#include "PackedStateStore.h"
+#include "QuantizedQTable.h"
+#include "LRTDP.h"
 #include <map>
 #include <cmath>
 
@@ -89,11 +94,40 @@ public:
   /**
     Pointer to the value function of this maze. If this is an original maze, \a valueFn is allocated here, and should be deallocated by this maze as well.
   */
-  vector<double>* valueFn;
+  vector<QValue>* valueFn;
   /**
     Pointer to the Q function of this maze. If this is an original maze, \a collabQFn is allocated here, and should be deallocated by this maze as well.
   */
-  vector<vector <double> >* collabQFn;
+  vector<vector <QValue> >* collabQFn;
+  /**
+    The Q function of this maze once quantized (see quantizeQFn), in place of \a collabQFn,
+    which is then 0. Owned like \a collabQFn.
+  */
+  QuantizedQTable* quantQFn;
+
+  /**
+    @return Q value of \a compoundAct in virtual state \a vState, from whichever of
+    \a collabQFn and \a quantQFn holds the Q function
+  */
+  QValue getCollabQValue(long vState, long compoundAct) const {
+    return quantQFn? quantQFn->get(vState, compoundAct) : (*collabQFn)[vState][compoundAct];
+  };
+
+  /**
+    Copies the Q values of virtual state \a vState into \a row.
+  */
+  void getCollabQValues(long vState, vector<QValue>& row) const {
+    if (quantQFn)
+      quantQFn->getRow(vState, row);
+    else
+      row = (*collabQFn)[vState];
+  };
+
+  /**
+    Replaces \a collabQFn with its int16 quantization in \a quantQFn. Original mazes
+    only; replicas pick it up through copyValueQFns.
+  */
+  void quantizeQFn();
   
   /******** Geometrical info from mazeWorld **********/
   /**
@@ -134,13 +168,20 @@ public:
   /******* for raw state *****************************/
   
   /**
-    Maps from AbstractState to \a index. This is only constructed if the maze is solved with abstraction.
+    Maps between \a index and AbstractState, bit-packed. Index 0 is the terminal dummy.
+  */
+  PackedStateStore* stateStore;
+  /**
+    Constant-time AbstractState -> \a index lookup for raw mazes. When it can be built,
+    \a stateStore does not build its own lookup table.
   */
-  map<AbstractState, long, Utilities::AbstractStateComparator>* vAbsStateMap;
+  RawStateIndexer* rawStateIndexer;
   /**
-    Maps from \a index to AbstractState. This is only constructed if the maze is solved with abstraction.
+    The maze is indexed lazily: getLongFromAbsState adds states to \a stateStore as they
+    are reached. Only set when the maze is solved by LRTDP, which never enumerates the
+    state space.
   */
-  vector<AbstractState>* reverseVAbsStateMap; // index -> state
+  bool lazyIndex;
   
   /********************************/
 
@@ -149,15 +190,16 @@ public:
   /**
     Full constructor.
   */
-  Maze(long wType, MazeWorld* mazeWorld, Monster* monster = 0, SpecialLocation* sLoc = 0, Player* h = 0, Player* a = 0) : worldType(wType), mazeWorld(mazeWorld), monster(monster), specialLocation(sLoc)
+  Maze(long wType, MazeWorld* mazeWorld, Monster* monster = 0, SpecialLocation* sLoc = 0, Player* h = 0, Player* a = 0) : worldType(wType), mazeWorld(mazeWorld), monster(monster), specialLocation(sLoc), stateStore(0), rawStateIndexer(0), lazyIndex(false)
   {
+    quantQFn = 0;
     player[0] = h;
     player[1] = a;
   };
   /**
     Default constructor. Not supposed to be used.
   */
-  Maze(){ specialLocation = 0; monster=0;};
+  Maze(){ specialLocation = 0; monster=0; stateStore = 0; rawStateIndexer = 0; lazyIndex = false; quantQFn = 0;};
   
   
   /************ Initialization ******************************/
@@ -170,8 +212,9 @@ public:
     @param[in] orig the maze to be copied from.
   */
   void copyStateMap(Maze* orig){
-  	vAbsStateMap = orig->vAbsStateMap;
-  	reverseVAbsStateMap = orig->reverseVAbsStateMap;
+  	stateStore = orig->stateStore;
+  	rawStateIndexer = orig->rawStateIndexer;
+  	lazyIndex = orig->lazyIndex;
   	virtualSize = orig->virtualSize;
   	if (useAbstract) visibleNearByRegions = orig->visibleNearByRegions;
   }
@@ -184,6 +227,8 @@ public:
   void copyValueQFns(Maze* orig){
     valueFn = orig->valueFn;
     collabQFn = orig->collabQFn;
+    quantQFn = orig->quantQFn;
+    virtualSize = orig->virtualSize;
   };
   
   /**
@@ -246,6 +291,33 @@ public:
     Generates the raw state maps. It is NOT implemented yet.
   */
   void generateRawStateMap();
+  /**
+    Drops the states that the dynamics cannot reach from \a seeds (state indices in the
+    current map; the terminal state is always kept), found by breadth-first search, and
+    renumbers the rest in their original order. Called right after generateStateMap, so
+    the model and Q tables only cover reachable states.
+  */
+  void pruneUnreachableStates(const std::vector<long>& seeds);
+  /**
+    Keeps the states \a s with \a keep[s] set, renumbered in their original order, in every
+    map the maze has.
+  */
+  void keepStates(const std::vector<char>& keep);
+  /**
+    Starts an empty lazily indexed state map (see \a lazyIndex) holding only the terminal
+    state, instead of enumerating the states.
+  */
+  void generateLazyStateMap();
+  /**
+    Adopts \a states, e.g. read back from a .Map file, as the state map instead of
+    enumerating the states. The maze takes ownership of \a states.
+  */
+  void useStateMap(PackedStateStore* states);
+  /**
+    Builds the AbstractState -> \a index lookup of \a stateStore: a RawStateIndexer for raw
+    mazes whose states fit one, the store's own table otherwise.
+  */
+  void indexStateMap();
   
   /**
     Enumerates \a agentIndex's visibility and coords where appropriate, e.g. when it is in the \a visionLimit of monster. 
@@ -282,20 +354,47 @@ public:
     If generateModel is called, V and Q functions store values of normal State.
   */
   void generateModel();
+  /**
+    Solves a lazily indexed maze with LRTDP from the state indices \a seeds. \a collabQFn and
+    the state map end up covering only the states LRTDP expanded.
+  */
+  void solveLRTDP(const std::vector<long>& seeds);
+  /**
+    Rewards and next state distributions of every compound action in \a state, for LRTDP.
+    Uses the same half-steps as constructTRCompAct.
+  */
+  void expandState(long state, std::vector<QValue>& rewards, std::vector<sparseStateBelief>& next);
 
   // construction methods for value functions and Q functions
   /**
     Constructs transition and reward matrices by invoking a lot of absVirtualDynamics, depending on \a useAbstract flag.
-    @param[out] transitionMatrix
-    @param[out] rewardMatrix
+    @param[out] transitionMatrix CSR transition model with its rewards, rows appended in (state, compoundAct) order
   */
-  void constructTRCompAct(vector < vector < vector < pair<long, double> > > >& transitionMatrix, vector < vector < double > >& rewardMatrix);
+  void constructTRCompAct(SparseTransitionModel& transitionMatrix);
+  /**
+    Runs absVirtualDynamics for every compound action of states [\a begin, \a end). Transitions
+    are appended to \a entries with each row's end offset in \a rowEnds and its reward in
+    \a rewards. Only touches its own buffers, so ranges can be built concurrently.
+  */
+  void constructTRRange(long begin, long end, sparseStateBelief& entries,
+      vector<long>& rowEnds, vector<QValue>& rewards);
+  /**
+    pthread entry for constructTRRange.
+  */
+  static void* constructTRWorker(void* arg);
   /**
     Constructs Q functions using previously computed transition and reward matrices.
     @param[in] transitionMatrix
-    @param[in] rewardMatrix
   */
-  void constructCollabQFns(vector < vector < vector < pair<long, double> > > >& transitionMatrix, vector < vector < double > >& rewardMatrix);
+  void constructCollabQFns(SparseTransitionModel& transitionMatrix);
+
+  /**
+    Reads the Q function this maze wrote earlier for mazeWorld->warmStartFile and turns it into
+    start values for the solver, V(s) = max_a Q(s,a).
+    @param[out] initValues start values, one per state
+    @return false (cold start) if there is no such file or it was solved for a different number of states
+  */
+  bool readWarmStartValues(vector<QValue>& initValues);
 
   /**
      Implements the dynamics of this Maze, with abstraction flag on.
@@ -306,6 +405,33 @@ public:
      @param[out] tranProb Sparse representation of next abstract state probabilities given current state and current actions. Note that tranProb should be kept sorted ordered by stateNum (first param) WHY???
   */
   virtual double absVirtualDynamics(const long currAbsState, const long hAct, const long aAct, sparseStateBelief& tranProb);
+
+  /**
+     Outcome of the human's half of a joint step, shared by every assistant action.
+  */
+  struct HumanHalfStep {
+    /**
+       The current state is terminal, there is nothing to fan out.
+    */
+    bool terminal;
+    AbstractState prevAbsState;
+    /**
+       Human action actually executed, e.g. unchanged if the move was blocked.
+    */
+    long humanAct;
+    abstractStateBelief outcome;
+  };
+
+  /**
+     First half of absVirtualDynamics: executes \a hAct in \a currAbsState.
+  */
+  void absHumanHalfStep(const long currAbsState, const long hAct, HumanHalfStep& step);
+
+  /**
+     Second half of absVirtualDynamics: executes \a aAct and the maze's dynamics on top of \a step.
+     @return expected reward, with \a tranProb as in absVirtualDynamics
+  */
+  double absAssistantHalfStep(const HumanHalfStep& step, const long aAct, sparseStateBelief& tranProb);
   
   /**
     Returns true if AbstractState \a absState is terminal, false otherwise.
@@ -332,7 +458,7 @@ public:
     @param[in] agentIndex 0 is Human, 1 is Assistant.
     @param[out] output the vector of posterior AbstractState with probability.
   */
-  virtual void absExecuteAgentMoveAct(std::vector< std::pair<AbstractState, double> >& input, long& action, int agentIndex, std::vector< std::pair<AbstractState, double> >& output);
+  virtual void absExecuteAgentMoveAct(abstractStateBelief& input, long& action, int agentIndex, abstractStateBelief& output);
   
   /**
     Executes movement action of \a agentIndex, invoked by absExecuteAgentMoveAct when this Maze has monster.
@@ -341,11 +467,9 @@ public:
     @param[in] agentIndex 0 is Human, 1 is Assistant.
     @param[out] output the vector of posterior AbstractState with probability.
   */
-  virtual void absExecuteAgentMoveAct_gotMonster(std::vector< std::pair<AbstractState, double> >& input, long &action, int agentIndex, std::vector< std::pair<AbstractState, double> >& output);
+  virtual void absExecuteAgentMoveAct_gotMonster(abstractStateBelief& input, long &action, int agentIndex, abstractStateBelief& output);
   
-  void executeAgentMoveAct_gotMonster(std::vector<std::pair<
-      AbstractState, double> >& input, long &action, int agentIndex, std::vector<
-      std::pair<AbstractState, double> >& output);
+  void executeAgentMoveAct_gotMonster(abstractStateBelief& input, long &action, int agentIndex, abstractStateBelief& output);
 
 
   /**
@@ -355,7 +479,7 @@ public:
     @param[in] agentIndex 0 is Human, 1 is Assistant.
     @param[out] output the vector of posterior AbstractState with probability.
   */
-  virtual void absExecuteAgentMoveAct_noMonster(std::vector< std::pair<AbstractState, double> >& input, long &action, int agentIndex, std::vector< std::pair<AbstractState, double> >& output)
+  virtual void absExecuteAgentMoveAct_noMonster(abstractStateBelief& input, long &action, int agentIndex, abstractStateBelief& output)
   { /* to be implemented*/ };
   
   /**
@@ -369,7 +493,7 @@ public:
     @param[out] output the vector of posterior AbstractState with probability.
     @param[in] prevAbsState the AbstractState prior to applying \a humanAct and \a aiAct.
   */
-  void absExecuteMonsterMoveAct(AbstractState& currAbsState, double prob, long humanAct, long aiAct, long act, double probAct, std::vector< std::pair<AbstractState, double> >& output, const AbstractState& prevAbsState);
+  void absExecuteMonsterMoveAct(AbstractState& currAbsState, double prob, long humanAct, long aiAct, long act, double probAct, abstractStateBelief& output, const AbstractState& prevAbsState);
   
   /**
     Executes Maze dynamics. This invokes monster and specialLocation's reactions. This routine should take care of the dynamics of shared items as well.
@@ -379,7 +503,7 @@ public:
     @param[out] output the vector of posterior AbstractState with probability.
     @param[in] prevAbsState the AbstractState prior to applying \a humanAct and \a aiAct.
   */
-  virtual void absExecuteMazeDynamics(std::vector< std::pair<AbstractState, double> >& input, long humanAct, long aiAct, std::vector< std::pair<AbstractState, double> >& output,  const AbstractState& prevAbsState);
+  virtual void absExecuteMazeDynamics(abstractStateBelief& input, long humanAct, long aiAct, abstractStateBelief& output,  const AbstractState& prevAbsState);
   
   /********** For abstract ******************/
   /**
@@ -392,11 +516,11 @@ public:
     @param[in] states the vector of AbstractState with probability to be evaluated.
     @param[out] rewards the returned vector of probability-weighted rewards corresponding to \a states
   */
-  void absGetRewards(std::vector< std::pair<AbstractState, double> >& states, std::vector <double>& rewards);
+  void absGetRewards(abstractStateBelief& states, std::vector <double>& rewards);
   /**
     Returns the long index (integer equivalence) of AbstractState \a abState
   */
-  long getLongFromAbsState(AbstractState& absState);
+  long getLongFromAbsState(const AbstractState& absState);
   /**
     Based on the actions executed by monster and Human/Assistant, updates the visibility and coordinates of Human and agent in \a absState, which possibly spawns new abstract states stored in tempOutput.
     @param[in] absState the prior AbstractState.
@@ -408,7 +532,7 @@ public:
     @param[in] priorMonsterY prior coordinate Y of NPC.
     @param[in] prevAbsState the AbstractState prior to applying \a humanAct, \a aiAct and \a monsterAct.
   */
-  void updateVisibility(AbstractState& absState, std::vector< std::pair<AbstractState, double> >& output, long humanAct, long aiAct, long monsterAct, long priorMonsterX, long priorMonsterY, const AbstractState& prevAbsState);
+  void updateVisibility(AbstractState& absState, abstractStateBelief& output, long humanAct, long aiAct, long monsterAct, long priorMonsterX, long priorMonsterY, const AbstractState& prevAbsState);
   
   /**
    * Based on the exact coords of monster and players to update monster's visibility.
@@ -471,7 +595,7 @@ public:
     @param[in] agentIndex 0 = Human, 1 = Assistant.
     @param[in] prevAbsState the AbstractState prior to applying \a humanAct and \a aiAct.
   */
-  void updateVisibilityCoordsOneAgent(std::vector< std::pair<AbstractState, double> >& input, std::vector< std::pair<AbstractState, double> >& output, long monsterAct, long priorMonsterX, long priorMonsterY, long agentAct, int agentIndex, const AbstractState& prevAbsState);
+  void updateVisibilityCoordsOneAgent(abstractStateBelief& input, abstractStateBelief& output, long monsterAct, long priorMonsterX, long priorMonsterY, long agentAct, int agentIndex, const AbstractState& prevAbsState);
 
   
   /************** Raw state related ***************/
@@ -495,7 +619,7 @@ public:
     @param[in] newX optional coord
     @param[in] newY optional coord
   */
-  virtual void getCurrState(vector<long>& propertiesState, long newX=-1, long newY=-1);
+  virtual void getCurrState(PropertyVector& propertiesState, long newX=-1, long newY=-1);
   
   /**
     Used for In-game. Returns the reward of Maze \a worldNum.
@@ -15,17 +15,114 @@
 #include "rapidxml.hpp"
 #include "Compression.h"
 #include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace rapidxml;
 using namespace std;
 
+/**
+ Seed of the randomized start states used to prune the state maps.
+ */
+const unsigned ReachableStartsSeed = 1;
+
+/**
+ Start of every .Map file, followed by a StateMapHeader.
+ */
+const char StateMapMagic[8] = { 'C', 'A', 'P', 'I', 'R', 'M', 'A', 'P' };
+
+/**
+ Version of the .Map format. Bump it whenever the states, or their order, change for the
+ same level.
+ */
+const uint32_t StateMapVersion = 1;
+
+/**
+ Start of every binary .Ftn file, followed by a SolutionHeader. Compressed text files
+ start with a zlib header instead.
+ */
+const char SolutionMagic[8] = { 'C', 'A', 'P', 'I', 'R', 'F', 'T', 'N' };
+
+/**
+ Version of the binary .Ftn format.
+ */
+const uint32_t SolutionVersion = 1;
+
+/**
+ Offset of the Q array in a binary .Ftn file. Mappings are page aligned, so the rows
+ start on a cache line.
+ */
+const size_t SolutionDataOffset = 64;
+
+/**
+ Types of the values in the Q array of a binary .Ftn file.
+ */
+const uint32_t SolutionFloat = 1;
+const uint32_t SolutionDouble = 2;
+const uint32_t SolutionInt16 = 3;
+
+/**
+ Folds \a size bytes at \a data into \a hash (64-bit FNV-1a).
+ */
+static void hashBytes(uint64_t& hash, const void* data, size_t size) {
+	const unsigned char* bytes = (const unsigned char*) data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+}
+;
+
+template<class T>
+static void hashValue(uint64_t& hash, T value) {
+	hashBytes(hash, &value, sizeof(T));
+}
+;
+
+/**
+ @return hash of everything in \a desc that decides the states of the level's mazes
+ */
+static uint64_t hashLevel(const MazeWorldDescription& desc) {
+	uint64_t hash = 14695981039346656037ULL;
+	hashValue(hash, desc.xSize);
+	hashValue(hash, desc.ySize);
+	for (unsigned i = 0; i < desc.grid.size(); i++)
+		for (unsigned j = 0; j < desc.grid[i].size(); j++)
+			hashValue(hash, desc.grid[i][j]);
+	hashValue(hash, desc.numRegionPerAgent);
+	for (unsigned i = 0; i < desc.characters.size(); i++)
+		hashValue(hash, desc.characters[i]);
+	for (unsigned i = 0; i < desc.properties.size(); i++) {
+		hashValue(hash, desc.properties[i].first);
+		hashBytes(hash, desc.properties[i].second.first.c_str(),
+				desc.properties[i].second.first.size() + 1);
+		hashBytes(hash, desc.properties[i].second.second.c_str(),
+				desc.properties[i].second.second.size() + 1);
+	}
+	hashValue(hash, desc.visionLimit);
+	hashValue(hash, (long) desc.monsterBlock);
+	hashValue(hash, (long) desc.agentBlock);
+	hashValue(hash, (long) desc.monsterAgentBlock);
+	return hash;
+}
+;
+
 MazeWorld::MazeWorld(MazeWorldDescription& desc) :
-	xSize(desc.xSize), ySize(desc.ySize), grid(desc.grid),
+	Model(desc.discount), xSize(desc.xSize), ySize(desc.ySize), grid(desc.grid),
 			numRegionPerAgent(desc.numRegionPerAgent), gType(desc.gType),
 			monsterBlock(desc.monsterBlock),
 			agentBlock(desc.agentBlock), visionLimit(desc.visionLimit),
 			targetPrecision(desc.targetPrecision),
-			displayInterval(desc.displayInterval), Model(desc.discount) {
+			displayInterval(desc.displayInterval),
+			numThreads(desc.numThreads), numProcesses(desc.numProcesses), sweepType(desc.sweepType),
+			stateOrder(desc.stateOrder), evalSweeps(desc.evalSweeps),
+			actionElimination(desc.actionElimination),
+			warmStartFile(desc.warmStartFile), scratchDir(desc.scratchDir),
+			reachableStarts(desc.reachableStarts), lrtdpTrials(desc.lrtdpTrials),
+			stateMapFile(desc.stateMapFile), solutionFormat(desc.solutionFormat),
+			quantizeQ(desc.quantizeQ), levelHash(hashLevel(desc)) {
 	worldInitialize();
 }
 ;
@@ -204,7 +301,13 @@ void MazeWorld::generateStateMap() {
 		// if this is an original world
 		if (i == equivWorlds[i]) {
 			// already generated abstract map for mazes with monster
-			mazes[i]->generateStateMap();
+			if (lrtdpTrials > 0)
+				mazes[i]->generateLazyStateMap();
+			else if (!loadStateMap(i)) {
+				mazes[i]->generateStateMap();
+				if (reachableStarts > 0)
+					pruneStateMap(i);
+			}
 		} else {
 			mazes[i]->copyStateMap(mazes[equivWorlds[i]]);
 		}
@@ -212,13 +315,76 @@ void MazeWorld::generateStateMap() {
 }
 ;
 
+bool MazeWorld::loadStateMap(long mazeIndex) {
+	if (stateMapFile.empty())
+		return false;
+
+	Maze* maze = mazes[mazeIndex];
+	string mapFilename = stateMapFilename(stateMapFile, maze);
+	StateMapHeader header;
+	PackedStateStore* states = new PackedStateStore;
+	bool loaded = readStateMap(mapFilename, maze, header, states);
+	if (loaded && (header.lazy || header.reachableStarts != reachableStarts)) {
+		// a lazy map only lists the solved states, a differently pruned one other states
+		std::cout << "Ignoring " << mapFilename << ": "
+				<< (header.lazy? "indexed lazily" : "pruned to other starts") << std::endl;
+		loaded = false;
+	}
+	if (!loaded) {
+		delete states;
+		return false;
+	}
+
+	std::cout << "Loaded state map " << mapFilename << ": " << states->size()
+			<< " states" << std::endl;
+	maze->useStateMap(states);
+	return true;
+}
+;
+
+void MazeWorld::pruneStateMap(long mazeIndex) {
+	std::vector<long> seeds;
+	getStartStates(mazeIndex, seeds);
+	mazes[mazeIndex]->pruneUnreachableStates(seeds);
+}
+;
+
+void MazeWorld::getStartStates(long mazeIndex, std::vector<long>& seeds) {
+	// 1. Start states. Randomized ones use a fixed seed, so the solver and the game
+	// prune to the same map.
+	std::vector<State> starts(1);
+	getCurrState(starts[0]);
+	if (reachableStarts > 1) {
+		RandSource::init(ReachableStartsSeed);
+		RandSource randSource(1);
+		starts.resize(reachableStarts);
+		for (long s = 1; s < reachableStarts; s++)
+			getRandomizedState(starts[s], randSource);
+	}
+
+	// 2. Their indices in every world that shares this maze's state map
+	seeds.resize(0);
+	for (unsigned s = 0; s < starts.size(); s++)
+		for (unsigned k = 0; k < mazes.size(); k++)
+			if (equivWorlds[k] == mazeIndex)
+				seeds.push_back(mazes[mazeIndex]->realToVirtual(starts[s], k));
+}
+;
+
 void MazeWorld::generateModel() {
 	for (unsigned i = 0; i < mazes.size(); i++) {
 
 		// if this is an original world
 		if (i == equivWorlds[i]) {
 			// already generated abstract map for mazes with monster
-			mazes[i]->generateModel();
+			if (lrtdpTrials > 0) {
+				std::vector<long> seeds;
+				getStartStates(i, seeds);
+				mazes[i]->solveLRTDP(seeds);
+			} else
+				mazes[i]->generateModel();
+			if (quantizeQ)
+				mazes[i]->quantizeQFn();
 		} else {
 			mazes[i]->copyValueQFns(mazes[equivWorlds[i]]);
 		}
@@ -525,10 +691,18 @@ double MazeWorld::getQValue(const State& currState,
 	for (long i = 0; i < numWorlds; i++) {
 		currVState = mazes[i]->realToVirtual(currState, i);
 
-		if (currVState != longTermState) {
+		if (currVState == longTermState)
+			continue;
+
+		// a quantized row adds w * offset + (w * scale) * code
+		const QuantizedQTable* quantQFn = mazes[i]->quantQFn;
+		if (quantQFn)
+			sumQValue += wBelief[i] * quantQFn->offsetData()[currVState]
+					+ wBelief[i] * quantQFn->scaleData()[currVState]
+					* quantQFn->codeData()[currVState * quantQFn->getNumActs() + compoundAct];
+		else
 			sumQValue += (*(mazes[i]->collabQFn))[currVState][compoundAct]
 					* wBelief[i];
-		}
 	}
 	return sumQValue;
 }
@@ -579,8 +753,11 @@ long MazeWorld::getBestCompoundActInSubworld(const State& currState,
 	if (currVState == longTermState)
 		return 0;
 
-	if (playerAct < 0)
-		return Distribution::getMax( (*(mazes[subWorld]->collabQFn))[currVState], -1, -1);
+	if (playerAct < 0) {
+		vector<QValue> row;
+		mazes[subWorld]->getCollabQValues(currVState, row);
+		return Distribution::getMax(row, -1, -1);
+	}
 	else{
 
 		long bestCompoundAct, compAct;
@@ -595,8 +772,8 @@ long MazeWorld::getBestCompoundActInSubworld(const State& currState,
 			}
 			else compAct = aiAct*player[1]->getNumActs() + playerAct;
 
-			if ((*(mazes[subWorld]->collabQFn))[currVState][bestCompoundAct]
-			                  < (*(mazes[subWorld]->collabQFn))[currVState][compAct]) {
+			if (mazes[subWorld]->getCollabQValue(currVState, bestCompoundAct)
+			                  < mazes[subWorld]->getCollabQValue(currVState, compAct)) {
 				bestCompoundAct = compAct;
 			}
 		}
@@ -640,6 +817,7 @@ void MazeWorld::getBestCompoundActionsInSubtasks(const State& currState,
 
 	double maxQValue, value;
 	long compoundAct;
+	vector<QValue> row;
 	for (unsigned i = 0; i < numWorlds; i++) {
 
 		bestCompoundActions[i].clear();
@@ -649,10 +827,11 @@ void MazeWorld::getBestCompoundActionsInSubtasks(const State& currState,
 			tempVState = (mazes[i])->realToVirtual(currState, i);
 
 			if (playerAct < 0){
-				maxQValue = Distribution::getMaxValue((*(mazes[i])->collabQFn)[tempVState]);
+				mazes[i]->getCollabQValues(tempVState, row);
+				maxQValue = Distribution::getMaxValue(row);
 
 				for (long act = 0; act < numActs; act++) { // act = compound act
-					value = (*(mazes[i])->collabQFn)[tempVState][act];
+					value = row[act];
 					if (fabs(value - maxQValue) < tolerance)
 						bestCompoundActions[i].push_back(act);
 				}
@@ -663,10 +842,10 @@ void MazeWorld::getBestCompoundActionsInSubtasks(const State& currState,
 				long numAiActs = player[1-playerIndex]->getNumActs();
 				long act = 0;
 				compoundAct = getCompoundAct(playerAct, playerIndex, act);
-				maxQValue = (*(mazes[i])->collabQFn)[tempVState][compoundAct];
+				maxQValue = mazes[i]->getCollabQValue(tempVState, compoundAct);
 				for (act = 1; act < numAiActs; act++) {
 					compoundAct = getCompoundAct(playerAct, playerIndex, act);
-					value = (*(mazes[i])->collabQFn)[tempVState][compoundAct];
+					value = mazes[i]->getCollabQValue(tempVState, compoundAct);
 					if (maxQValue < value)
 						maxQValue = value;
 				}
@@ -674,7 +853,7 @@ void MazeWorld::getBestCompoundActionsInSubtasks(const State& currState,
 				// 2. add all compound actions within the maxQValue's tolerance
 				for (act = 0; act < numAiActs; act++) {
 					compoundAct = getCompoundAct(playerAct, playerIndex, act);
-					value = (*(mazes[i])->collabQFn)[tempVState][compoundAct];
+					value = mazes[i]->getCollabQValue(tempVState, compoundAct);
 					if (fabs(value - maxQValue) < tolerance)
 						bestCompoundActions[i].push_back(compoundAct);
 				}
@@ -1818,6 +1997,232 @@ char* MazeWorld::getPlayerString(int playerIndex) {
 	return result;
 }
 
+/**
+ Folds the \a size bytes of one Q row at \a data into \a checksum, a word at a time.
+ */
+static void checksumRow(uint64_t& checksum, const char* data, size_t size) {
+	for (size_t i = 0; i < size; i += sizeof(uint64_t)) {
+		uint64_t word = 0;
+		memcpy(&word, data + i, std::min(sizeof(uint64_t), size - i));
+		checksum = (checksum ^ word) * 0x9E3779B97F4A7C15ULL;
+		checksum ^= checksum >> 32;
+	}
+}
+;
+
+/**
+ Writes the Q function of \a maze as zlib-compressed fixed-point text: virtualSize,
+ then every Q value. The text is deflated as it is printed, a chunk at a time.
+ */
+static void writeTextQFunction(ofstream& fp, const Maze* maze, long numActs) {
+	// -1 indicates default compression level, which is Z_BEST_COMPRESSION
+	CompressedWriter input_string(fp, -1);
+
+	// Set floatfield to 5 digits, i.e. the maximum number of digits after decimal point is 4.
+	// weird???? why doesnt input_string.setf(0, ios::floatfield); work?
+	// damn the cplusplus examples.
+	input_string.setf(ios::fixed, ios::floatfield);
+	input_string.precision(5);
+
+	// 1. Write virtualSize
+	input_string << maze->virtualSize << " ";
+
+	// 2. Write collab Q Fns
+	long rows = maze->quantQFn? maze->quantQFn->size() : (long) maze->collabQFn->size();
+	for (long j = 0; j < rows; j++) {
+		// no need to write size, because size is always = numActs
+		for (long k = 0; k < numActs; k++) {
+			input_string << maze->getCollabQValue(j, k) << " ";
+		}
+	}
+	input_string.finish();
+
+	if (!input_string) {
+		cerr << "Fail to compress the Q function of " << maze->worldTypeStr << "\n";
+		exit(EXIT_FAILURE);
+	}
+
+	std::cout << "Deflated data: " << input_string.rawSize() << " -> "
+			<< input_string.compressedSize() << " (" << std::setprecision(1)
+			<< std::fixed << ((1.0 - (float) input_string.compressedSize()
+			/ (float) input_string.rawSize()) * 100.0) << "% saved).\n";
+}
+;
+
+/**
+ Writes the Q function of \a maze in the binary format: magic, SolutionHeader, padding
+ up to SolutionDataOffset, then the Q array. Rows of QValue are written as they are in
+ memory; a quantized Q function as its offsets, its scales, then its rows of codes.
+ */
+static void writeBinaryQFunction(ofstream& fp, const Maze* maze, long numActs) {
+	SolutionHeader header;
+	header.version = SolutionVersion;
+	header.numActs = numActs;
+	header.checksum = 0;
+
+	const QuantizedQTable* quantQFn = maze->quantQFn;
+	size_t rowSize, size;
+	if (quantQFn) {
+		header.dtype = SolutionInt16;
+		header.virtualSize = quantQFn->size();
+		rowSize = numActs * sizeof(int16_t);
+		size = header.virtualSize * (2 * sizeof(float) + rowSize);
+		checksumRow(header.checksum, (const char*) quantQFn->offsetData(),
+				header.virtualSize * sizeof(float));
+		checksumRow(header.checksum, (const char*) quantQFn->scaleData(),
+				header.virtualSize * sizeof(float));
+		for (long j = 0; j < header.virtualSize; j++)
+			checksumRow(header.checksum, (const char*) (quantQFn->codeData() + j * numActs), rowSize);
+	} else {
+		header.dtype = (sizeof(QValue) == sizeof(float))? SolutionFloat : SolutionDouble;
+		header.virtualSize = maze->collabQFn->size();
+		rowSize = numActs * sizeof(QValue);
+		size = header.virtualSize * rowSize;
+		for (long j = 0; j < header.virtualSize; j++)
+			checksumRow(header.checksum, (const char*) &(*(maze->collabQFn))[j][0], rowSize);
+	}
+
+	char padding[SolutionDataOffset] = { 0 };
+	fp.write(SolutionMagic, sizeof(SolutionMagic));
+	fp.write((const char*) &header, sizeof(header));
+	fp.write(padding, SolutionDataOffset - sizeof(SolutionMagic) - sizeof(header));
+	if (quantQFn) {
+		fp.write((const char*) quantQFn->offsetData(), header.virtualSize * sizeof(float));
+		fp.write((const char*) quantQFn->scaleData(), header.virtualSize * sizeof(float));
+		fp.write((const char*) quantQFn->codeData(), header.virtualSize * rowSize);
+	} else {
+		for (long j = 0; j < header.virtualSize; j++)
+			fp.write((const char*) &(*(maze->collabQFn))[j][0], rowSize);
+	}
+
+	std::cout << "Wrote " << header.virtualSize << " x " << numActs
+			<< (quantQFn? " quantized" : "") << " Q values ("
+			<< SolutionDataOffset + size << " bytes).\n";
+}
+;
+
+/**
+ Parses the compressed text Q function file \a subWorldFilename, mapped at \a data,
+ \a length bytes long, inflating it a chunk at a time.
+ */
+static bool readTextQFunction(const string& subWorldFilename, const char* data,
+		size_t length, long numActs, long& virtualSize, vector<vector<QValue> >& qFn) {
+	CompressedReader output_string(data, length);
+
+	// start reading numbers from output_string
+	output_string >> virtualSize;
+
+	// Read virtual collab Q Functions
+	if (output_string && virtualSize >= 0) {
+		qFn.resize(virtualSize);
+		for (long j = 0; j < virtualSize; j++) {
+			qFn[j].resize(numActs);
+			for (long k = 0; k < numActs; k++)
+				output_string >> qFn[j][k];
+		}
+	}
+
+	if (!output_string || virtualSize < 0) {
+		cerr << subWorldFilename << " is corrupt\n";
+		return false;
+	}
+	return true;
+}
+;
+
+template<class T>
+static void copyRow(const char* data, long numActs, vector<QValue>& row) {
+	const T* values = (const T*) data;
+	row.assign(values, values + numActs);
+}
+;
+
+/**
+ Checks the binary Q function file \a subWorldFilename mapped at \a data, \a length bytes
+ long, and copies its Q array into \a quantized if it is quantized and \a quantized is
+ given, or else into \a qFn, converting it to QValue if needed.
+ */
+static bool readBinaryQFunction(const string& subWorldFilename, const char* data,
+		size_t length, long numActs, long& virtualSize, vector<vector<QValue> >& qFn,
+		QuantizedQTable* quantized) {
+	SolutionHeader header;
+	if (length < SolutionDataOffset) {
+		cerr << subWorldFilename << " is truncated\n";
+		return false;
+	}
+	memcpy(&header, data + sizeof(SolutionMagic), sizeof(header));
+	if (header.version != SolutionVersion) {
+		cerr << subWorldFilename << " is a version " << header.version
+				<< " Q function, expected version " << SolutionVersion << "\n";
+		return false;
+	}
+	if (header.dtype != SolutionFloat && header.dtype != SolutionDouble
+			&& header.dtype != SolutionInt16) {
+		cerr << subWorldFilename << " holds unknown Q value type " << header.dtype << "\n";
+		return false;
+	}
+	if (header.numActs != numActs) {
+		cerr << subWorldFilename << " has " << header.numActs << " actions, expected "
+				<< numActs << "\n";
+		return false;
+	}
+	size_t rowSize, stateSize;
+	if (header.dtype == SolutionInt16) {
+		rowSize = numActs * sizeof(int16_t);
+		stateSize = 2 * sizeof(float) + rowSize;
+	} else {
+		rowSize = numActs * ((header.dtype == SolutionFloat)? sizeof(float) : sizeof(double));
+		stateSize = rowSize;
+	}
+	if (header.virtualSize < 0 || length != SolutionDataOffset + header.virtualSize * stateSize) {
+		cerr << subWorldFilename << " is truncated\n";
+		return false;
+	}
+
+	// quantized files hold the offsets and the scales ahead of the rows
+	const char* array = data + SolutionDataOffset;
+	const float* offsets = (const float*) array;
+	const float* scales = offsets + header.virtualSize;
+	const char* rows = array;
+	uint64_t checksum = 0;
+	if (header.dtype == SolutionInt16) {
+		rows = (const char*) (scales + header.virtualSize);
+		checksumRow(checksum, (const char*) offsets, header.virtualSize * sizeof(float));
+		checksumRow(checksum, (const char*) scales, header.virtualSize * sizeof(float));
+	}
+	for (long j = 0; j < header.virtualSize; j++)
+		checksumRow(checksum, rows + j * rowSize, rowSize);
+	if (checksum != header.checksum) {
+		cerr << subWorldFilename << " is corrupt: checksum mismatch\n";
+		return false;
+	}
+
+	virtualSize = header.virtualSize;
+	if (header.dtype == SolutionInt16 && quantized) {
+		quantized->resize(virtualSize, numActs);
+		memcpy(quantized->offsetData(), offsets, virtualSize * sizeof(float));
+		memcpy(quantized->scaleData(), scales, virtualSize * sizeof(float));
+		memcpy(quantized->codeData(), rows, virtualSize * rowSize);
+		qFn.resize(0);
+		return true;
+	}
+
+	qFn.resize(virtualSize);
+	for (long j = 0; j < virtualSize; j++) {
+		if (header.dtype == SolutionInt16) {
+			const int16_t* codes = (const int16_t*) (rows + j * rowSize);
+			qFn[j].resize(numActs);
+			for (long k = 0; k < numActs; k++)
+				qFn[j][k] = offsets[j] + scales[j] * codes[k];
+		} else if (header.dtype == SolutionFloat)
+			copyRow<float>(rows + j * rowSize, numActs, qFn[j]);
+		else
+			copyRow<double>(rows + j * rowSize, numActs, qFn[j]);
+	}
+	return true;
+}
+;
+
 void MazeWorld::writeSolution(std::string filename) {
 	/**
 	 Only write a pointer to earlier model when
@@ -1835,14 +2240,15 @@ void MazeWorld::writeSolution(std::string filename) {
 
 	/**
 	 * New: Write filename.worldTypeStr.Ftn for each of the world type.
-	 * Format:
+	 * Format (textSolution, compressed):
 	 * virtualSize
 	 * Q value
+	 * Format (binarySolution): see SolutionHeader
 	 *
 	 * */
 	ofstream fp;
 
-	unsigned j, k;
+	long vectorSize = player[0]->getNumActs() * player[1]->getNumActs();
 	std::string subWorldFilename;
 	for (long i = 0; i < mazes.size(); i++) {
 		// This is an original world
@@ -1865,105 +2271,131 @@ void MazeWorld::writeSolution(std::string filename) {
 				cerr << "Fail to open " << subWorldFilename << "\n";
 				exit(EXIT_FAILURE);
 			}
-			stringstream input_string;
-
-			// Set floatfield to 5 digits, i.e. the maximum number of digits after decimal point is 4.
-			// weird???? why doesnt input_string.setf(0, ios::floatfield); work?
-			// damn the cplusplus examples.
-			input_string.setf(ios::fixed, ios::floatfield);
-			input_string.precision(5);
-
-			// 3. Write virtualSize
-			input_string << mazes[i]->virtualSize << " ";
-
-			// 5. Write collab Q Fns
-			for (j = 0; j < (*(mazes[i]->collabQFn)).size(); j++) {
-				// no need to write size, because size is always = numActs
-				// input_string << (*(mazes[i]->collabQFn))[j].size() << " ";
-
-				for (k = 0; k < (*(mazes[i]->collabQFn))[j].size(); k++) {
-					input_string << (*(mazes[i]->collabQFn))[j][k] << " ";
-				}
-			}
-
-			// std::cout << "Raw string~~~~~~\n"<< input_string.str() << std::endl << "~~~~~~~~~~" << std::endl;
-
-			// Compress the input_string
-			// -1 indicates default compression level, which is Z_BEST_COMPRESSION
-			std::string raw_str = input_string.str();
-			std::string compressed_str = Compression::compress_string(raw_str, -1);
-
-			fp.write(compressed_str.c_str(), compressed_str.size());
-
-			std::cout << "Deflated data: " << raw_str.size() << " -> "
-					<< compressed_str.size() << " (" << std::setprecision(1)
-					<< std::fixed << ((1.0 - (float) compressed_str.size()
-					/ (float) raw_str.size()) * 100.0) << "% saved).\n";
+			if (solutionFormat == Utilities::binarySolution)
+				writeBinaryQFunction(fp, mazes[i], vectorSize);
+			else
+				writeTextQFunction(fp, mazes[i], vectorSize);
 
 			fp.close();
 
-			/*
-			// 2. Write reverseVAbsStateMap
-			// Write the number of states first, then the size of each component of AbstractState
-
-			std::cout << "~~~ Writing state map reverseVAbsStateMap ~~~ "
-					<< mazes[i]->worldTypeStr << "~~" << std::endl;
-
-			subWorldFilename = filename + "." + mazes[i]->worldTypeStr;
+			// 2. The states of the rows, so the Q rows of lazily indexed mazes can be placed,
+			// and later runs can load the state map instead of enumerating it
+			writeStateMap(stateMapFilename(filename, mazes[i]), mazes[i]);
+		} // original world
+	} // for world
+}
+;
 
-			if (mazes[i]->useAbstract)
-				subWorldFilename += ".1.Map";
-			else
-				subWorldFilename += ".0.Map";
+string MazeWorld::solutionFilename(const string& filename, const Maze* maze) {
+	string subWorldFilename = filename + "." + maze->worldTypeStr;
 
-			fp.open(subWorldFilename.c_str(), ofstream::binary);
-			if (!fp.is_open()) {
-				cerr << "Fail to open " << subWorldFilename << "\n";
-				exit(EXIT_FAILURE);
-			}
-			stringstream mapString;
+	if (maze->useAbstract)
+		subWorldFilename += ".1.Ftn";
+	else
+		subWorldFilename += ".0.Ftn";
+	return subWorldFilename;
+}
+;
 
-			mapString.setf(ios::fixed, ios::floatfield);
-			mapString.precision(5);
+string MazeWorld::stateMapFilename(const string& filename, const Maze* maze) {
+	string subWorldFilename = solutionFilename(filename, maze);
+	return subWorldFilename.substr(0, subWorldFilename.size() - 4) + ".Map";
+}
+;
 
-			// a. Write map size
-			mapString << mazes[i]->reverseVAbsStateMap->size() << " ";
+uint64_t MazeWorld::stateMapHash(const Maze* maze) const {
+	uint64_t hash = levelHash;
+	hashBytes(hash, maze->worldTypeStr.data(), maze->worldTypeStr.size());
+	hashValue(hash, maze->visionLimit);
+	hashValue(hash, (long) maze->useAbstract);
+	return hash;
+}
+;
 
-			// b. Write component size. The first element of reverseVAbsStateMap is reserved for
-			// terminal state right?
-			mapString << (*(mazes[i]->reverseVAbsStateMap))[1].playerProperties[0].size() << " ";
-			mapString << (*(mazes[i]->reverseVAbsStateMap))[1].playerProperties[1].size() << " ";
+void MazeWorld::writeStateMap(const string& mapFilename, const Maze* maze) {
+	std::cout << "~~~ Writing state map ~~~ " << maze->worldTypeStr << "~~"
+			<< std::endl;
 
-			mapString << (*(mazes[i]->reverseVAbsStateMap))[1].monsterProperties.size() << " ";
-			mapString << (*(mazes[i]->reverseVAbsStateMap))[1].specialLocationProperties.size() << " ";
+	ofstream fp;
+	fp.open(mapFilename.c_str(), ofstream::binary);
+	if (!fp.is_open()) {
+		cerr << "Fail to open " << mapFilename << "\n";
+		exit(EXIT_FAILURE);
+	}
 
-			// c. Write each state into stringstream
-			// state[0] is special
-			AbstractState tempState;
-			Utilities::cloneAbsState((*(mazes[i]->reverseVAbsStateMap))[1], tempState);
-			tempState.playerProperties[0][0] = TermState; // 0 is regionID
-			tempState.playerProperties[0][1] = TermState; // 1 is X
+	StateMapHeader header;
+	header.version = StateMapVersion;
+	header.lazy = maze->lazyIndex;
+	header.geometryHash = stateMapHash(maze);
+	header.reachableStarts = maze->lazyIndex? 0 : reachableStarts;
 
-			Utilities::AbstractStateToOutStream(tempState, mapString);
-			// state[1] onwards are normal
-			for (j = 1; j < mazes[i]->reverseVAbsStateMap->size(); j++)
-				Utilities::AbstractStateToOutStream((*(mazes[i]->reverseVAbsStateMap))[j], mapString);
+	fp.write(StateMapMagic, sizeof(StateMapMagic));
+	fp.write((const char*) &header, sizeof(header));
+	maze->stateStore->write(fp);
+	fp.close();
+}
+;
 
-			// d. Compress and write to file
-			raw_str = mapString.str();
-			compressed_str = Compression::compress_string(raw_str, -1);
+bool MazeWorld::readStateMap(const string& mapFilename, const Maze* maze,
+		StateMapHeader& header, PackedStateStore* states) {
+	ifstream fp;
+	fp.open(mapFilename.c_str(), ios::in | ios::binary);
+	if (!fp.is_open())
+		return false;
 
-			fp.write(compressed_str.c_str(), compressed_str.size());
+	char magic[sizeof(StateMapMagic)];
+	fp.read(magic, sizeof(magic));
+	fp.read((char*) &header, sizeof(header));
+	if (fp.fail() || memcmp(magic, StateMapMagic, sizeof(magic)) != 0
+			|| header.version != StateMapVersion) {
+		std::cout << "Ignoring " << mapFilename << ": not a version "
+				<< StateMapVersion << " state map" << std::endl;
+		return false;
+	}
+	if (header.geometryHash != stateMapHash(maze)) {
+		std::cout << "Ignoring stale " << mapFilename
+				<< ": written for another level" << std::endl;
+		return false;
+	}
 
-			std::cout << "Deflated data: " << raw_str.size() << " -> "
-					<< compressed_str.size() << " (" << std::setprecision(1)
-					<< std::fixed << ((1.0 - (float) compressed_str.size()
-					/ (float) raw_str.size()) * 100.0) << "% saved).\n";
+	if (states && !states->read(fp)) {
+		std::cout << "Ignoring " << mapFilename << ": truncated" << std::endl;
+		return false;
+	}
+	return true;
+}
+;
 
-			fp.close();
-			 */
-		} // original world
-	} // for world
+bool MazeWorld::readQFunction(const string& subWorldFilename, long numActs,
+		long& virtualSize, vector<vector<QValue> >& qFn, QuantizedQTable* quantized) {
+	int fd = open(subWorldFilename.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return false;
+	}
+	size_t length = st.st_size;
+	void* mapped = mmap(0, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (mapped == MAP_FAILED) {
+		cerr << "Fail to map " << subWorldFilename << "\n";
+		return false;
+	}
+	// both formats are read front to back once
+	madvise(mapped, length, MADV_SEQUENTIAL);
+
+	const char* data = (const char*) mapped;
+	bool ok;
+	if (length >= sizeof(SolutionMagic)
+			&& memcmp(data, SolutionMagic, sizeof(SolutionMagic)) == 0)
+		ok = readBinaryQFunction(subWorldFilename, data, length, numActs, virtualSize, qFn,
+				quantized);
+	else
+		ok = readTextQFunction(subWorldFilename, data, length, numActs, virtualSize, qFn);
+	munmap(mapped, length);
+	return ok;
 }
 ;
 
@@ -1973,10 +2405,8 @@ void MazeWorld::readSolution(std::string filename) {
 	 */
 
 	// Suppose we already have equivWorlds setup here.
-	ifstream fp;
-
 	std::string subWorldFilename;
-	unsigned worldIndex, j, k, i;
+	unsigned i;
 	long vectorSize = player[0]->getNumActs() * player[1]->getNumActs();
 
 	// For each virtual world
@@ -1984,63 +2414,66 @@ void MazeWorld::readSolution(std::string filename) {
 		// Check if this world is original
 		if (equivWorlds[i] == i) {
 
-			subWorldFilename = filename + "." + mazes[i]->worldTypeStr;
-
-			if (mazes[i]->useAbstract)
-				subWorldFilename += ".1.Ftn";
-			else
-				subWorldFilename += ".0.Ftn";
+			subWorldFilename = solutionFilename(filename, mazes[i]);
 
-			fp.open(subWorldFilename.c_str(), ios::in | ios::binary);
-			if (!fp.is_open()) {
-				cerr << "Fail to open " << subWorldFilename << "\n";
-				exit(EXIT_FAILURE);
-			}
 			std::cout << "~~~ Reading Q function from file~~~ "
 					<< mazes[i]->worldTypeStr << "~~" << std::endl;
 
-			// Read and decompress data to string.
-			int length;
-			char * buffer;
-
-			// get length of file:
-			fp.seekg(0, ios::end);
-			length = fp.tellg();
-			fp.seekg(0, ios::beg);
-
-			// allocate memory:
-			buffer = new char[length];
-
-			// read data as a block:
-			fp.read(buffer, length);
-			fp.close();
-
-			std::string compressed_str(buffer, length);
-
-			delete[] buffer;
-
-			std::string raw_str = Compression::decompress_string(compressed_str);
-			stringstream output_string(raw_str);
-
-			// ------
-
 			// By now, all the mazes should have been initialized.
 			// I just need to read in their Q fns.
+			mazes[i]->collabQFn = new vector<vector<QValue> > ;
+			QuantizedQTable* quantized = new QuantizedQTable;
+			if (!readQFunction(subWorldFilename, vectorSize, mazes[i]->virtualSize,
+					*(mazes[i]->collabQFn), quantized)) {
+				cerr << "Fail to open " << subWorldFilename << "\n";
+				exit(EXIT_FAILURE);
+			}
+			if (quantized->getNumActs() > 0) {
+				delete mazes[i]->collabQFn;
+				mazes[i]->collabQFn = 0;
+				mazes[i]->quantQFn = quantized;
+			} else
+				delete quantized;
+
+			// A lazily solved maze lists the states of its rows: place every row at its
+			// state's index here. States without a row get 0 for every action, i.e. no
+			// preference in this world.
+			string mapFilename = stateMapFilename(filename, mazes[i]);
+			StateMapHeader header;
+			PackedStateStore states;
+			if (readStateMap(mapFilename, mazes[i], header, 0) && header.lazy
+					&& readStateMap(mapFilename, mazes[i], header, &states)) {
+				AbstractState state;
+				vector<long> index(states.size(), longTermState);
+				for (long j = 1; j < states.size(); j++) {
+					states.get(j, state);
+					index[j] = mazes[i]->getLongFromAbsState(state);
+				}
 
-			// start reading numbers from output_string
-			output_string >> mazes[i]->virtualSize;
-
-			// Read virtual collab Q Functions
-			mazes[i]->collabQFn = new vector<vector<double> > ;
-			mazes[i]->collabQFn->resize(mazes[i]->virtualSize);
-
-			for (j = 0; j < mazes[i]->virtualSize; j++) {
-				// output_string >> vectorSize;
-				(*(mazes[i]->collabQFn))[j].resize(vectorSize);
-				for (k = 0; k < vectorSize; k++)
-					output_string >> (*(mazes[i]->collabQFn))[j][k];
+				mazes[i]->virtualSize = mazes[i]->stateStore->size();
+				if (mazes[i]->quantQFn)
+					mazes[i]->quantQFn->scatter(index, mazes[i]->virtualSize);
+				else {
+					vector<vector<QValue> > rows;
+					rows.swap(*(mazes[i]->collabQFn));
+					mazes[i]->collabQFn->assign(mazes[i]->virtualSize,
+							vector<QValue> (vectorSize, 0));
+					for (long j = 0; j < states.size() && j < (long) rows.size(); j++)
+						if (index[j] >= 0)
+							(*(mazes[i]->collabQFn))[index[j]].swap(rows[j]);
+				}
+			} else if (mazes[i]->virtualSize != mazes[i]->stateStore->size()) {
+				// Otherwise row j is state j: a file solved over other states, e.g. pruned
+				// with another -r, would put its rows on the wrong states
+				cerr << subWorldFilename << " has " << mazes[i]->virtualSize
+						<< " states, the state map has " << mazes[i]->stateStore->size()
+						<< "\n";
+				exit(EXIT_FAILURE);
 			}
 
+			if (quantizeQ)
+				mazes[i]->quantizeQFn();
+
 		} else {
 
 			// NO - this world is a replica of a previous world
@@ -2054,6 +2487,39 @@ void MazeWorld::readSolution(std::string filename) {
 }
 ;
 
+void MazeWorld::compareSolution(std::string filename) {
+	long vectorSize = player[0]->getNumActs() * player[1]->getNumActs();
+
+	for (unsigned i = 0; i < numWorlds; i++) {
+		if (equivWorlds[i] != i)
+			continue;
+
+		std::string subWorldFilename = solutionFilename(filename, mazes[i]);
+		vector<vector<QValue> > refQFn;
+		long refSize;
+		if (!readQFunction(subWorldFilename, vectorSize, refSize, refQFn)) {
+			cerr << "Fail to open " << subWorldFilename << "\n";
+			continue;
+		}
+		if (refSize != mazes[i]->virtualSize) {
+			cerr << subWorldFilename << " has " << refSize << " states, expected "
+					<< mazes[i]->virtualSize << "\n";
+			continue;
+		}
+
+		double maxDeviation = 0;
+		for (long j = 0; j < refSize; j++)
+			for (long k = 0; k < vectorSize; k++)
+				if (fabs((double) mazes[i]->getCollabQValue(j, k) - refQFn[j][k]) > maxDeviation)
+					maxDeviation = fabs((double) mazes[i]->getCollabQValue(j, k) - refQFn[j][k]);
+
+		std::cout << "Max Q deviation from " << subWorldFilename << ": "
+				<< std::scientific << std::setprecision(3) << maxDeviation
+				<< std::endl;
+	}
+}
+;
+
 // TODO ---------------------- Destructor
 MazeWorld::~MazeWorld() {
 	if (player[0]) {
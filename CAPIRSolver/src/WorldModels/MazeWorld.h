@@ -35,6 +35,40 @@ using namespace std;
  @author Truong Huy Nguyen
  @date December 2010
  */
+/**
+ Header of a .Map state map file, written after the 8-byte magic "CAPIRMAP", in native
+ byte order. The states follow, as written by PackedStateStore::write.
+ */
+struct StateMapHeader
+{
+	uint32_t version;
+	// 1 if the maze was indexed lazily (LRTDP): only the solved states are listed, in the
+	// order they were reached
+	uint32_t lazy;
+	// stateMapHash of the maze the states belong to
+	uint64_t geometryHash;
+	// reachableStarts the states were pruned with, 0 if they were not
+	int64_t reachableStarts;
+};
+
+/**
+ Header of a binary .Ftn Q function file, written after the 8-byte magic "CAPIRFTN", in
+ native byte order. The Q array starts at the 64-byte aligned offset SolutionDataOffset:
+ virtualSize rows of numActs values of type dtype. A quantized (SolutionInt16) array
+ holds virtualSize float offsets and virtualSize float scales ahead of its rows of
+ int16 codes, see QuantizedQTable.
+ */
+struct SolutionHeader
+{
+	uint32_t version;
+	// SolutionFloat, SolutionDouble or SolutionInt16
+	uint32_t dtype;
+	int64_t virtualSize;
+	int64_t numActs;
+	// checksum of the Q array, row by row
+	uint64_t checksum;
+};
+
 class MazeWorld: public Model {
 protected:
 	/**
@@ -103,6 +137,64 @@ public:
 	 Time interval to display the value's difference.
 	 */
 	long displayInterval;
+	/**
+	 Number of threads used by each value iteration sweep.
+	 */
+	long numThreads;
+	/**
+	 Number of forked worker processes sharing each Jacobi sweep, overrides numThreads when above 1.
+	 */
+	long numProcesses;
+	/**
+	 Jacobi or in-place Gauss-Seidel sweeps, and the state order used by the latter.
+	 */
+	ValueIteration::sweepType sweepType;
+	ValueIteration::stateOrderType stateOrder;
+	/**
+	 Policy evaluation sweeps per improvement for modified policy iteration, 0 to use value iteration.
+	 */
+	long evalSweeps;
+	/**
+	 Drop provably suboptimal actions during Jacobi value iteration.
+	 */
+	bool actionElimination;
+	/**
+	 Map file whose existing .Ftn solution seeds value iteration. Empty means cold start.
+	 */
+	string warmStartFile;
+	/**
+	 Directory the transition model and its rewards are streamed to and mapped from. Empty keeps them in memory.
+	 */
+	string scratchDir;
+	/**
+	 Number of start states the state maps are pruned to by reachability: the level's own
+	 start plus reachableStarts - 1 randomized ones. 0 keeps every enumerated state.
+	 */
+	long reachableStarts;
+	/**
+	 Maximum number of LRTDP trials. Above 0, state maps are indexed lazily and each
+	 maze is solved by LRTDP from the start states instead of value iteration.
+	 */
+	long lrtdpTrials;
+	/**
+	 Map file whose .Map state maps are loaded instead of enumerating the states, when they
+	 were written for this level. Empty always enumerates.
+	 */
+	string stateMapFile;
+	/**
+	 Format of the .Ftn files written by writeSolution.
+	 */
+	Utilities::solutionFormatType solutionFormat;
+	/**
+	 Keep the Q functions quantized to int16 (see Maze::quantizeQFn), in memory and in
+	 binary .Ftn files.
+	 */
+	bool quantizeQ;
+	/**
+	 Hash of the level description: grid, regions, characters and their properties,
+	 vision and blocking. See stateMapHash.
+	 */
+	uint64_t levelHash;
 
 	/******* Computed geographical info ****/
 	// for computing shortest path
@@ -224,16 +316,69 @@ public:
 	/**
 	 Write out the QFns to \a filename. Exploit
 	 \a equivWorlds - only write a pointer to earlier model when
-	 model is equivalent.
+	 model is equivalent. Each file is written in \a solutionFormat.
 	 */
 	void writeSolution(string filename);
 
 	/**
 	 Read in the QFns from file \a filename and
-	 reconstruct collabQFn of all mazes.
+	 reconstruct collabQFn of all mazes. Quantized files are kept quantized in quantQFn.
 	 */
 	void readSolution(string filename);
 
+	/**
+	 Compare the Q functions in memory against the ones written to \a filename
+	 (e.g. by a double precision run) and print the maximum absolute deviation
+	 for every original maze.
+	 */
+	void compareSolution(string filename);
+
+	/**
+	 @return filename.worldTypeStr.{1|0}.Ftn, the Q function file of \a maze.
+	 */
+	static string solutionFilename(const string& filename, const Maze* maze);
+
+	/**
+	 Reads one Q function file written by \a writeSolution, in either format. The file is
+	 mapped read-only; binary files are copied straight out of the mapping.
+	 @param[out] virtualSize number of states stored in the file
+	 @param[out] qFn the Q function, \a numActs values per state
+	 @param[out] quantized if given, receives the Q function of a quantized file as is,
+	 leaving \a qFn empty. Otherwise quantized files are dequantized into \a qFn.
+	 @return false if the file cannot be opened, or is a binary file of another version, of
+	 another number of actions, or corrupt
+	 */
+	static bool readQFunction(const string& subWorldFilename, long numActs,
+			long& virtualSize, vector<vector<QValue> >& qFn, QuantizedQTable* quantized = 0);
+
+	/**
+	 @return filename.worldTypeStr.{1|0}.Map, the state map file of \a maze.
+	 */
+	static string stateMapFilename(const string& filename, const Maze* maze);
+
+	/**
+	 Writes the state map of \a maze, in index order, to \a mapFilename: a StateMapHeader,
+	 then the bit-packed states.
+	 */
+	void writeStateMap(const string& mapFilename, const Maze* maze);
+
+	/**
+	 Reads a state map written by \a writeStateMap for \a maze. State 0 is the terminal state.
+	 @param[out] header the header of the file
+	 @param[out] states the states, or 0 to only read the header
+	 @return false if the file cannot be opened, is not a state map of this version, or is
+	 stale, i.e. was written for another level or maze type
+	 */
+	bool readStateMap(const string& mapFilename, const Maze* maze,
+			StateMapHeader& header, PackedStateStore* states);
+
+	/**
+	 Identifies the states \a maze enumerates: \a levelHash combined with the maze's type,
+	 vision limit and abstraction. It does not cover the enumeration code, whose changes
+	 bump the state map version instead.
+	 */
+	uint64_t stateMapHash(const Maze* maze) const;
+
 	/**
 	 Deallocate resources assigned.
 	 */
@@ -281,6 +426,22 @@ public:
 	 Invokes corresponding function of Maze's. Each original world stores its own class state map, which would then be copied over by worlds of the same type.
 	 */
 	void generateStateMap();
+	/**
+	 Gives original world \a mazeIndex the state map in its stateMapFile .Map file, if
+	 there is one matching the level and the pruning (reachableStarts) of this run.
+	 @return false if the states have to be enumerated
+	 */
+	bool loadStateMap(long mazeIndex);
+	/**
+	 Prunes the state map of original world \a mazeIndex to the states reachable from the
+	 start states (see reachableStarts), as seen by every world sharing that map.
+	 */
+	void pruneStateMap(long mazeIndex);
+	/**
+	 Indices of the start states (the level's own start and reachableStarts - 1 randomized
+	 ones) in the state map of original world \a mazeIndex, as seen by every world sharing it.
+	 */
+	void getStartStates(long mazeIndex, std::vector<long>& seeds);
 	/**
 	 Invokes corresponding function of Maze's. This computes the V and Q functions.
 	 */
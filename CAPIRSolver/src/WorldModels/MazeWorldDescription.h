@@ -16,6 +16,7 @@
 
 #include "Model.h"
 #include "Utilities.h"
+#include "ValueIteration.h"
 #include <cstring>
 
 using namespace std;
@@ -65,6 +66,28 @@ struct MazeWorldDescription
   double targetPrecision;
   double discount;  
   long displayInterval;
+  long numThreads;
+  long numProcesses;
+  ValueIteration::sweepType sweepType;
+  ValueIteration::stateOrderType stateOrder;
+  long evalSweeps;
+  bool actionElimination;
+  // map file whose .Ftn files seed value iteration, empty for a cold start
+  string warmStartFile;
+  // directory for the out-of-core transition model, empty to keep it in memory
+  string scratchDir;
+  // 0 to solve every enumerated state, n > 0 to keep only the states reachable from the
+  // level's start and n - 1 randomized starts
+  long reachableStarts;
+  // 0 to enumerate and solve every state, n > 0 to solve with at most n LRTDP trials
+  long lrtdpTrials;
+  // map file whose .Map state maps are loaded instead of enumerating the states when
+  // they match the level, empty to always enumerate
+  string stateMapFile;
+  // format of the .Ftn files writeSolution writes; both are read back
+  Utilities::solutionFormatType solutionFormat;
+  // keep the Q functions quantized to int16, in memory and in binary .Ftn files
+  bool quantizeQ;
 
   
 };
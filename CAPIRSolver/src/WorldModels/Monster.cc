@@ -44,7 +44,7 @@ void Monster::enumerateProperties(std::vector<AbstractState>& input,
 
 	AbstractState state;
 
-	vector<vector<long> > tempProperties;
+	vector<PropertyVector> tempProperties;
 	long currSize;
 
 	while (!input.empty()) {
@@ -68,16 +68,16 @@ void Monster::enumerateProperties(std::vector<AbstractState>& input,
 }
 ;
 
-void Monster::absReact(std::vector<std::pair<AbstractState, double> >& input,
+void Monster::absReact(abstractStateBelief& input,
     long humanAct, long aiAct,
-    std::vector<std::pair<AbstractState, double> >& output,
+    abstractStateBelief& output,
     const AbstractState& prevAbsState) {
 
 	output.resize(0);
 
 	AbstractState currAbsState;
 	double prob;
-	std::vector<std::pair<AbstractState, double> > tempOutput;
+	abstractStateBelief tempOutput;
 
 	// 1. If any of the player actions is special, i.e. can affect the monster's welfare.
 	if (maze->player[0]->isSpecialAct(humanAct) || maze->player[1]->isSpecialAct(
@@ -104,7 +104,7 @@ void Monster::absReact(std::vector<std::pair<AbstractState, double> >& input,
 ;
 
 void Monster::absReact(AbstractState& currAbsState, double prob, long humanAct, long aiAct,
-    std::vector<std::pair<AbstractState, double> >& output,
+    abstractStateBelief& output,
     const AbstractState& prevAbsState) {
 
 	long act;
@@ -174,7 +174,7 @@ void Monster::absReact(AbstractState& currAbsState, double prob, long humanAct,
  */
 void Monster::absExecuteSpecialAct(AbstractState& currAbsState, double prob,
     long humanAct, long aiAct, long act, double probAct,
-    std::vector<std::pair<AbstractState, double> >& output,
+    abstractStateBelief& output,
     const AbstractState& prevAbsState) {
 	Utilities::absDoNothing(currAbsState, prob * probAct, output);
 }
@@ -116,9 +116,9 @@ public:
 	 the corresponding \a absGetAct* routine. It then gather all
 	 possible resulted AbstractStates into \a output.
 	 */
-	void absReact(std::vector<std::pair<AbstractState, double> >& input,
+	void absReact(abstractStateBelief& input,
 	    long humanAct, long aiAct,
-	    std::vector<std::pair<AbstractState, double> >& output,
+	    abstractStateBelief& output,
 	    const AbstractState& prevAbsState);
 
 	/*
@@ -126,7 +126,7 @@ public:
 	 * */
 	virtual void absReact(AbstractState& currAbsState, double prob,
 	    long humanAct, long aiAct,
-	    std::vector<std::pair<AbstractState, double> >& output,
+	    abstractStateBelief& output,
 	    const AbstractState& prevAbsState);
 
 	/**
@@ -137,8 +137,8 @@ public:
 	 @param[in] output array of AbstractState with probability.
 	 */
 	virtual void absGetAffectedByPlayersActions(
-	    std::vector<std::pair<AbstractState, double> >& input, long humanAct,
-	    long aiAct, std::vector<std::pair<AbstractState, double> >& output) {
+	    abstractStateBelief& input, long humanAct,
+	    long aiAct, abstractStateBelief& output) {
 		Utilities::copyAbstractProbArray(input, output);
 	}
 	;
@@ -156,7 +156,7 @@ public:
 	 */
 	virtual void absExecuteSpecialAct(AbstractState& currAbsState, double prob,
 	    long humanAct, long aiAct, long act, double probAct,
-	    std::vector<std::pair<AbstractState, double> >& output,
+	    abstractStateBelief& output,
 	    const AbstractState& prevAbsState);
 
 	/**
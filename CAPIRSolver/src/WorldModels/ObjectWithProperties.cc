@@ -14,7 +14,7 @@
 #include "ObjectWithProperties.h"
 
 
-void ObjectWithProperties::enumerateProperties(std::vector< long >& currProperties, std::vector< std::vector<long> >& output)
+void ObjectWithProperties::enumerateProperties(PropertyVector& currProperties, std::vector< PropertyVector >& output)
 { 
   output.resize(0);
   output.push_back(currProperties);
@@ -24,10 +24,10 @@ void ObjectWithProperties::enumerateProperties(std::vector< long >& currProperti
   }
 };
 
-void ObjectWithProperties::enumeratePropertyAt(std::vector< std::vector<long> >& output, long pIndex)
+void ObjectWithProperties::enumeratePropertyAt(std::vector< PropertyVector >& output, long pIndex)
 {
-  std::vector< std::vector<long> > tempOutput(0);
-  std::vector<long> currProp;
+  std::vector< PropertyVector > tempOutput(0);
+  PropertyVector currProp;
   
   while(!output.empty()){
     currProp = output.back();
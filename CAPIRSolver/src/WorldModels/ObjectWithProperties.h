@@ -90,17 +90,17 @@ public:
     @param[in] currProperties the partially filled array of properties.
     @param[out] output the array of filled properties.
   */
-  virtual void enumerateProperties(std::vector< long >& currProperties, std::vector< std::vector<long> >& output);
+  virtual void enumerateProperties(PropertyVector& currProperties, std::vector< PropertyVector >& output);
   
   /**
     Enumerate property at index \a pIndex in an in-place manner.
     @param[out] output
   */
-  void enumeratePropertyAt(std::vector< std::vector<long> >& output, long pIndex);
+  void enumeratePropertyAt(std::vector< PropertyVector >& output, long pIndex);
   /**
     Reacts at planning stage given players' actions \a humanAct and \a aiAct. This routine is used in Monster and SpecialLocation. By default, does nothing. 
   */
-  virtual void absReact(std::vector< std::pair<AbstractState, double> >& input, long humanAct, long aiAct, std::vector< std::pair<AbstractState, double> >& output, const AbstractState& prevAbsState)
+  virtual void absReact(abstractStateBelief& input, long humanAct, long aiAct, abstractStateBelief& output, const AbstractState& prevAbsState)
   { Utilities::copyAbstractProbArray(input, output); };
   
   /**
@@ -118,7 +118,7 @@ public:
   /**
     Amend \a propertiesState with initial property values.
   */
-  virtual void getCurrState(std::vector<long>& propertiesState)
+  virtual void getCurrState(PropertyVector& propertiesState)
   {
     for (unsigned i=0; i<properties.size(); i++)
       propertiesState.push_back(properties[i]);   
@@ -25,7 +25,7 @@ void Player::enumerateProperties(std::vector<AbstractState>& input,
 
 	AbstractState state;
 
-	vector<vector<long> > tempProperties;
+	vector<PropertyVector> tempProperties;
 	long currSize;
 
 	while (!input.empty()) {
@@ -62,6 +62,7 @@ void Player::getBestCompoundActions(const State& currState,
 	long numActs = getNumActs() * mazeWorld->player[1 - agentIndex]->getNumActs();
 
 	double maxQValue, value;
+	vector<QValue> row;
 	for (unsigned i = 0; i < mazeWorld->numWorlds; i++) {
 
 		bestCompoundActions[i].clear();
@@ -69,10 +70,11 @@ void Player::getBestCompoundActions(const State& currState,
 		// if this is not terminal state
 		if (!mazeWorld->mazes[i]->isTermState(currState, i)) {
 			tempVState = (mazeWorld->mazes[i])->realToVirtual(currState, i);
-			maxQValue = Distribution::getMaxValue((*(mazeWorld->mazes[i])->collabQFn)[tempVState]);
+			mazeWorld->mazes[i]->getCollabQValues(tempVState, row);
+			maxQValue = Distribution::getMaxValue(row);
 
 			for (long act = 0; act < numActs; act++) { // act = compound act
-				value = (*(mazeWorld->mazes[i])->collabQFn)[tempVState][act];
+				value = row[act];
 				if (fabs(value - maxQValue) < OPTIMAL_EPS)
 					bestCompoundActions[i].push_back(act);
 			}
@@ -118,16 +120,16 @@ void Player::getActionModel(const State& currState,
 			for (act = 0; act < getNumActs(); act++) { // act = human act
 
 				// 1. get max value of (*(mazeWorld->mazes[i])->collabQFn)[tempVState][compAct] where act is part of
-				maxQValue = (*(mazeWorld->mazes[i])->collabQFn)[tempVState][0];
+				maxQValue = mazeWorld->mazes[i]->getCollabQValue(tempVState, 0);
 				for (unsigned partnerAct = 0; partnerAct < mazeWorld->player[1
 				    - agentIndex]->getNumActs(); partnerAct++) {
 					if (agentIndex == humanIndex)
-						tempQValue = (*(mazeWorld->mazes[i])->collabQFn)[tempVState][act
-						    * mazeWorld->player[1 - agentIndex]->getNumActs() + partnerAct];
+						tempQValue = mazeWorld->mazes[i]->getCollabQValue(tempVState, act
+						    * mazeWorld->player[1 - agentIndex]->getNumActs() + partnerAct);
 					else
 						tempQValue
-						    = (*(mazeWorld->mazes[i])->collabQFn)[tempVState][partnerAct
-						        * getNumActs() + act];
+						    = mazeWorld->mazes[i]->getCollabQValue(tempVState, partnerAct
+						        * getNumActs() + act);
 					if (maxQValue < tempQValue)
 						maxQValue = tempQValue;
 				}
@@ -109,8 +109,8 @@ public:
 	 @param[in] output array of AbstractState with probability.
 	 */
 	virtual void absExecuteSpecialAct(
-	    std::vector<std::pair<AbstractState, double> >& input, long act,
-	    std::vector<std::pair<AbstractState, double> >& output) {
+	    abstractStateBelief& input, long act,
+	    abstractStateBelief& output) {
 		Utilities::copyAbstractProbArray(input, output);
 	}
 	;
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2012 Truong-Huy D. Nguyen.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the GNU Public License v3.0
+ * which accompanies this distribution, and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * 
+ * Contributors:
+ *     Truong-Huy D. Nguyen - initial API and implementation
+ */
+
+
+
+#include "RawStateIndexer.h"
+
+/**
+ Largest table accepted, relative to the number of states.
+ */
+const long MaxTableOverhead = 16;
+
+const PropertyVector& RawStateIndexer::group(const AbstractState& state, int g) {
+	switch (g) {
+	case 0:
+		return state.playerProperties[humanIndex];
+	case 1:
+		return state.playerProperties[aiIndex];
+	case 2:
+		return state.monsterProperties;
+	default:
+		return state.specialLocationProperties;
+	}
+}
+;
+
+bool RawStateIndexer::build(const PackedStateStore& states,
+    const std::vector<std::vector<long> >* cellRank, long numCells) {
+	this->cellRank = cellRank;
+	this->numCells = numCells;
+	table.clear();
+	if (states.size() < 2)
+		return false;
+
+	// 1. The layout comes from the first real state: (region, x, y, <properties>) for the
+	// players, (x, y, seesHuman, seesAssistant, <properties>) for the monster
+	AbstractState first, state;
+	states.get(1, first);
+	hasMonster = !first.monsterProperties.empty();
+	propStart[0] = propStart[1] = 3;
+	propStart[2] = 4;
+	propStart[3] = 0;
+	for (int g = 0; g < 4; g++) {
+		groupSize[g] = group(first, g).size();
+		propLength[g] = (groupSize[g] > propStart[g])? groupSize[g] - propStart[g] : 0;
+	}
+
+	// 2. One radix per property slot, from the largest value it takes
+	radix.assign(propLength[0] + propLength[1] + propLength[2] + propLength[3], 1);
+	for (long s = 1; s < states.size(); s++) {
+		states.get(s, state);
+		long slot = 0;
+		for (int g = 0; g < 4; g++) {
+			const PropertyVector& props = group(state, g);
+			if ((long) props.size() != groupSize[g])
+				return false;
+			for (long p = 0; p < propLength[g]; p++, slot++) {
+				long value = props[propStart[g] + p];
+				if (value < 0)
+					return false;
+				if (value + 1 > radix[slot])
+					radix[slot] = value + 1;
+			}
+		}
+	}
+
+	// 3. Size the table; give up if it would dwarf the state space
+	double size = (double) numCells * numCells * (hasMonster? numCells : 1);
+	for (unsigned r = 0; r < radix.size(); r++)
+		size *= radix[r];
+	if (size > (double) MaxTableOverhead * states.size() || size > INT_MAX)
+		return false;
+
+	// 4. Fill in the indices; two states with the same key mean the layout is ambiguous
+	table.assign((long) size, -1);
+	for (long s = 1; s < states.size(); s++) {
+		states.get(s, state);
+		long k = key(state);
+		if (k < 0 || table[k] >= 0) {
+			table.clear();
+			return false;
+		}
+		table[k] = s;
+	}
+	return true;
+}
+;
+
+long RawStateIndexer::key(const AbstractState& state) const {
+	const int x = 1, y = 2;
+	long k = 0, cell;
+
+	for (int agent = 0; agent < 2; agent++) {
+		if (state.playerProperties[agent].size() <= (unsigned) y)
+			return -1;
+		cell = (*cellRank)[state.playerProperties[agent][x]][state.playerProperties[agent][y]];
+		if (cell < 0)
+			return -1;
+		k = k * numCells + cell;
+	}
+	if (hasMonster) {
+		if (state.monsterProperties.size() < 2)
+			return -1;
+		cell = (*cellRank)[state.monsterProperties[0]][state.monsterProperties[1]];
+		if (cell < 0)
+			return -1;
+		k = k * numCells + cell;
+	}
+
+	long slot = 0;
+	for (int g = 0; g < 4; g++) {
+		const PropertyVector& props = group(state, g);
+		if ((long) props.size() != groupSize[g])
+			return -1;
+		for (long p = 0; p < propLength[g]; p++, slot++) {
+			long value = props[propStart[g] + p];
+			if (value < 0 || value >= radix[slot])
+				return -1;
+			k = k * radix[slot] + value;
+		}
+	}
+	return k;
+}
+;
+
+void RawStateIndexer::renumber(const std::vector<long>& newIndex) {
+	for (unsigned k = 0; k < table.size(); k++)
+		if (table[k] >= 0)
+			table[k] = newIndex[table[k]];
+}
+;
+
+long RawStateIndexer::find(const AbstractState& state) const {
+	if (table.empty())
+		return -1;
+	long k = key(state);
+	return (k < 0)? -1 : table[k];
+}
+;
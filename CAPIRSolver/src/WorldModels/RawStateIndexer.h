@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2012 Truong-Huy D. Nguyen.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the GNU Public License v3.0
+ * which accompanies this distribution, and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * 
+ * Contributors:
+ *     Truong-Huy D. Nguyen - initial API and implementation
+ */
+
+
+
+#ifndef __RAWSTATEINDEXER_H
+#define __RAWSTATEINDEXER_H
+
+#include <vector>
+#include "Utilities.h"
+#include "PackedStateStore.h"
+
+/**
+  @class RawStateIndexer
+  @brief Constant-time index lookup for raw (non-abstract) maze states.
+  @details A raw state is the human's, the assistant's and the monster's grid cells plus
+  a handful of small integer properties. Each cell is ranked among the accessible cells
+  (gridNodeLabel) and each property slot gets a radix, so every state has a mixed-radix
+  key; a dense table maps keys to the state indices the state map was enumerated with.
+  Visibility flags and region ids are derived from the cells, so they are not part of
+  the key.
+*/
+class RawStateIndexer
+{
+public:
+  RawStateIndexer() : cellRank(0), numCells(0) {};
+
+  /**
+    Builds the key table over \a states, where state 0 is the terminal dummy.
+    @param[in] cellRank rank of every accessible cell, -1 for walls
+    @param[in] numCells number of accessible cells
+    @return false if the states do not fit a mixed-radix layout (two states share a key,
+    negative property values, or a table much larger than the state space). The
+    indexer is then unusable.
+  */
+  bool build(const PackedStateStore& states, const std::vector<std::vector<long> >* cellRank, long numCells);
+
+  /**
+    @return index of \a state, or -1 if it is not one of the indexed states
+  */
+  long find(const AbstractState& state) const;
+
+  /**
+    Moves every state \a s to index \a newIndex[s]; states mapped to -1 are no longer found.
+  */
+  void renumber(const std::vector<long>& newIndex);
+
+  /**
+    Approximate number of bytes held by the key table.
+  */
+  long memoryUsage() const { return table.capacity() * sizeof(int); };
+
+private:
+  const std::vector<std::vector<long> >* cellRank;
+  long numCells;
+  bool hasMonster;
+
+  /**
+    Property slots after the coordinates (and the monster's visibility flags), in key
+    order: human, assistant, monster, special location.
+  */
+  long groupSize[4];
+  long propStart[4];
+  long propLength[4];
+  std::vector<long> radix;
+
+  /**
+    Key -> state index, -1 for keys that are not states.
+  */
+  std::vector<int> table;
+
+  /**
+    @return the properties of \a group in \a state
+  */
+  static const PropertyVector& group(const AbstractState& state, int g);
+
+  /**
+    @return the key of \a state, or -1 if it does not fit the layout
+  */
+  long key(const AbstractState& state) const;
+};
+
+#endif // __RAWSTATEINDEXER_H
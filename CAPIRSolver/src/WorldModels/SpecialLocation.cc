@@ -24,7 +24,7 @@ void SpecialLocation::enumerateProperties(std::vector< AbstractState >& input, s
   
   AbstractState state;
   
-  std::vector< std::vector<long> > tempProperties;
+  std::vector< PropertyVector > tempProperties;
   long currSize;
   
   while (!input.empty()){
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2012 Truong-Huy D. Nguyen.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the GNU Public License v3.0
+ * which accompanies this distribution, and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * 
+ * Contributors:
+ *     Truong-Huy D. Nguyen - initial API and implementation
+ */
+
+
+
+#include "BellmanBackup.h"
+#include "Utilities.h"
+#include <sys/time.h>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+
+using namespace std;
+
+/**
+   Microbenchmark for the Bellman backup kernels. Builds a random MDP shaped
+   like a raw GhostBusters maze (few successors per action) and times full
+   sweeps with the generic kernel and each specialized kernel.
+*/
+int main(int argc, char **argv)
+{
+  long numStates = 140000;
+  long numActions = 30;
+  long maxSuccessors = 4;
+  long numSweeps = 20;
+  double discount = 0.99;
+
+  if (argc > 1) numStates = atol(argv[1]);
+  if (argc > 2) numActions = atol(argv[2]);
+  if (argc > 3) numSweeps = atol(argv[3]);
+  if (argc == 1)
+    cout << "Usage: BellmanBenchmark [numStates] [numActions] [numSweeps]\n";
+
+  // 1. Random MDP
+  srand(1);
+  SparseTransitionModel transMatrix(numStates, numActions);
+  vector<pair<long, double> > row;
+  for (long i = 0; i < numStates; i++){
+    for (long j = 0; j < numActions; j++){
+      double reward = (rand() % 100) / 10.0 - 5;
+      long numSucc = 1 + rand() % maxSuccessors;
+      row.clear();
+      for (long k = 0; k < numSucc; k++)
+        row.push_back(pair<long, double>(rand() % numStates, 1.0 / numSucc));
+      transMatrix.addRow(row, reward);
+    }
+  }
+  transMatrix.shrinkToFit();
+
+  // 2. Time each kernel
+  const char* names[4];
+  BellmanBackupKernel kernels[4];
+  names[0] = "current (generic)";
+  kernels[0] = BellmanBackup::genericBackup;
+  kernels[1] = BellmanBackup::selectKernel(numActions, BellmanBackup::scalarISA, &names[1]);
+  kernels[2] = BellmanBackup::selectKernel(numActions, BellmanBackup::sseISA, &names[2]);
+  kernels[3] = BellmanBackup::selectKernel(numActions, BellmanBackup::avx2ISA, &names[3]);
+  long numKernels = (BellmanBackup::detectISA() == BellmanBackup::avx2ISA)? 4 : 3;
+
+  vector<QValue> reference;
+  for (long kernel = 0; kernel < numKernels; kernel++){
+    vector<QValue> values[2];
+    values[0].assign(numStates, 0);
+    values[1].assign(numStates, 0);
+    long bestAction;
+
+    struct timeval start, end;
+    gettimeofday(&start, NULL);
+    for (long s = 0; s < numSweeps; s++){
+      vector<QValue>& prev = values[s % 2];
+      vector<QValue>& curr = values[(s + 1) % 2];
+      for (long i = 0; i < numStates; i++)
+        curr[i] = kernels[kernel](transMatrix.stateRewards(i), transMatrix, i, &prev[0],
+            discount, numActions, bestAction, 0);
+    }
+    gettimeofday(&end, NULL);
+
+    long ms = Utilities::getMilsecDiff(start, end);
+    if (ms < 1) ms = 1;
+    if (kernel == 0)
+      reference = values[numSweeps % 2];
+    bool same = (values[numSweeps % 2] == reference);
+    cout << names[kernel] << ": " << (numStates * numSweeps * 1000.0 / ms)
+         << " backups/sec (" << ms << " ms)" << (same? "" : " MISMATCH") << endl;
+  }
+  return 0;
+}
@@ -24,6 +24,20 @@ int main(int argc, char **argv)
   double discount = 0.99;
   double targetPrecision = 0.01;
   long displayInterval = 1;
+  long numThreads = 1;
+  long numProcesses = 1;
+  ValueIteration::sweepType sweepType = ValueIteration::jacobiSweep;
+  ValueIteration::stateOrderType stateOrder = ValueIteration::naturalOrder;
+  long evalSweeps = 0;
+  string compare_file;
+  bool warmStart = false;
+  bool loadStateMaps = false;
+  Utilities::solutionFormatType solutionFormat = Utilities::textSolution;
+  bool quantizeQ = false;
+  bool actionElimination = false;
+  string scratchDir;
+  long reachableStarts = 0;
+  long lrtdpTrials = 0;
   double visionLimit = 3;
   Utilities::goalType gType = Utilities::andType;
   
@@ -37,6 +51,20 @@ int main(int argc, char **argv)
 	  << "  -u useAbstract (default: 0)\n"
 	  << "  -p targetPrecision (default: 0.01)\n"
 	  << "  -d discountFactor (default: 0.99)\n"
+	  << "  -t numThreads for model construction and value iteration sweeps (default: 1)\n"
+	  << "  -j numProcesses: fork this many workers sharing the Jacobi sweeps through shared memory (default: 1; overrides -t)\n"
+	  << "  -s sweepType (default: 0, 0 = Jacobi, 1 = in-place Gauss-Seidel, 2 = SCC topological order; 1 and 2 single-threaded)\n"
+	  << "  -o stateOrder for Gauss-Seidel (default: 0, 0 = state index, 1 = reverse BFS from terminal state)\n"
+	  << "  -c mapfile of a reference run (e.g. double precision): report max Q deviation from its .Ftn files\n"
+	  << "  -w warmStart (0 or 1, default = 0; 1 seeds the solver from the existing mapfile .Ftn files when their state count matches)\n"
+	  << "  -n loadStateMaps (0 or 1, default = 0; 1 loads the existing mapfile .Map state maps instead of enumerating the states when they match the level)\n"
+	  << "  -f solutionFormat of the written .Ftn files (default: 0, 0 = compressed text, 1 = binary; both are read)\n"
+	  << "  -q quantizeQ (0 or 1, default = 0; 1 keeps the Q functions as int16 with a per-state offset and scale, also in binary .Ftn files)\n"
+	  << "  -e actionElimination (0 or 1, default = 0; 1 drops dominated actions during Jacobi sweeps)\n"
+	  << "  -x scratchDir: stream the transition model and rewards to files in scratchDir and sweep them from disk (default: in memory)\n"
+	  << "  -r reachableStarts: solve only the states reachable from the level's start and reachableStarts - 1 randomized starts (default: 0 = all states)\n"
+	  << "  -l lrtdpTrials: never enumerate the states, solve from the start states with at most lrtdpTrials LRTDP trials (default: 0 = value iteration)\n"
+	  << "  -k evalSweeps: use modified policy iteration with k evaluation sweeps per improvement (default: 0 = value iteration)\n"
 	  << "  -v visionLimit (default visionLimit for all mazes: 3)\n"
 	  << "  -g gType (default: 1, 0 = orType, 1 = and)\n" 
 	  << "  -1 monsterBlock (0 or 1, default = 1 meaning monster are blocked among each other)\n"
@@ -76,6 +104,52 @@ int main(int argc, char **argv)
     case 'd':
       discount = atof(argv[i]);
       break;
+    case 't':
+      numThreads = atoi(argv[i]);
+      break;
+    case 'j':
+      numProcesses = atoi(argv[i]);
+      break;
+    case 's':
+      {
+      int type = atoi(argv[i]);
+      sweepType = ((type == ValueIteration::gaussSeidelSweep || type == ValueIteration::topologicalSweep)?
+          (ValueIteration::sweepType) type : ValueIteration::jacobiSweep);
+      break;
+      }
+    case 'o':
+      stateOrder = ((atoi(argv[i]) == ValueIteration::reverseBFSOrder)? ValueIteration::reverseBFSOrder : ValueIteration::naturalOrder);
+      break;
+    case 'c':
+      compare_file = argv[i];
+      break;
+    case 'w':
+      warmStart = (atoi(argv[i]) == 1);
+      break;
+    case 'n':
+      loadStateMaps = (atoi(argv[i]) == 1);
+      break;
+    case 'f':
+      solutionFormat = ((atoi(argv[i]) == Utilities::binarySolution)? Utilities::binarySolution : Utilities::textSolution);
+      break;
+    case 'q':
+      quantizeQ = (atoi(argv[i]) == 1);
+      break;
+    case 'e':
+      actionElimination = (atoi(argv[i]) == 1);
+      break;
+    case 'x':
+      scratchDir = argv[i];
+      break;
+    case 'r':
+      reachableStarts = atoi(argv[i]);
+      break;
+    case 'l':
+      lrtdpTrials = atol(argv[i]);
+      break;
+    case 'k':
+      evalSweeps = atoi(argv[i]);
+      break;
     case 'v':
       visionLimit = atof(argv[i]);
       break;
@@ -102,6 +176,19 @@ int main(int argc, char **argv)
   currDescription.visionLimit = visionLimit; // default visionLimit
   currDescription.targetPrecision = targetPrecision;
   currDescription.displayInterval = displayInterval;
+  currDescription.numThreads = numThreads;
+  currDescription.numProcesses = numProcesses;
+  currDescription.sweepType = sweepType;
+  currDescription.stateOrder = stateOrder;
+  currDescription.evalSweeps = evalSweeps;
+  currDescription.actionElimination = actionElimination;
+  currDescription.warmStartFile = (warmStart? map_file : "");
+  currDescription.stateMapFile = (loadStateMaps? map_file : "");
+  currDescription.solutionFormat = solutionFormat;
+  currDescription.quantizeQ = quantizeQ;
+  currDescription.scratchDir = scratchDir;
+  currDescription.reachableStarts = reachableStarts;
+  currDescription.lrtdpTrials = lrtdpTrials;
   currDescription.gType = gType;
   currDescription.monsterBlock = monsterBlock;
   currDescription.agentBlock = agentBlock;
@@ -130,5 +217,9 @@ int main(int argc, char **argv)
   // 5. Write resultant policy to file
   currLevel.writeSolution(vqFns_file); // used to be writeModels: write Q functions to file
 
+  // 6. Optionally compare against a reference solution
+  if (!compare_file.empty())
+    currLevel.compareSolution(compare_file);
+
 };
 
@@ -24,8 +24,8 @@
  * Currently, this is deterministic and I'm not taking into account the human's HP or accuracy yet.
  * */
 void GB_Ghost::absGetAffectedByPlayersActions(
-		std::vector<std::pair<AbstractState, double> >& input, long humanAct,
-		long aiAct, std::vector<std::pair<AbstractState, double> >& output) {
+		abstractStateBelief& input, long humanAct,
+		long aiAct, abstractStateBelief& output) {
 	output.resize(0);
 
 	AbstractState currAbsState;
@@ -54,8 +54,8 @@ public:
 	 * When Ghost gets shot by a human or ai in its sight, it reduces its HP by one.
 	 * */
 	void absGetAffectedByPlayersActions(
-	    std::vector<std::pair<AbstractState, double> >& input, long humanAct,
-	    long aiAct, std::vector<std::pair<AbstractState, double> >& output);
+	    abstractStateBelief& input, long humanAct,
+	    long aiAct, abstractStateBelief& output);
 	/**
 	 * If the human shoots a ghost, its HP decreases by 1.
 	 * */
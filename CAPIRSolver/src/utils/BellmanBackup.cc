@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2012 Truong-Huy D. Nguyen.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the GNU Public License v3.0
+ * which accompanies this distribution, and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * 
+ * Contributors:
+ *     Truong-Huy D. Nguyen - initial API and implementation
+ */
+
+
+
+#include "BellmanBackup.h"
+#include <cfloat>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BELLMAN_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+double BellmanBackup::genericBackup(const QValue* reward, const SparseTransitionModel& transMatrix,
+    long state, const QValue* values, double discount, long numActions, long& bestAction, QValue* qRow)
+{
+  double bestValue = -FLT_MAX;
+  bestAction = 0;
+
+  for (long j = 0; j < numActions; j++){
+    // Compute discounted reward
+    double currValue = reward[j];
+    for (long k = transMatrix.rowBegin(state, j); k < transMatrix.rowEnd(state, j); k++){
+      long nextState = transMatrix.nextStates[k];
+      double prob = transMatrix.probs[k];
+      currValue +=  discount * prob * values[nextState];
+    }
+
+    if (qRow)
+      qRow[j] = (QValue) currValue;
+
+    // Seach for best discounted rewards among all actions in this state
+    if (currValue > bestValue){
+      bestValue = currValue;
+      bestAction = j;
+    }
+  }
+  return bestValue;
+};
+
+/**
+   Action values of \a state into \a q, same arithmetic as genericBackup.
+*/
+template <int NumActs>
+static inline void actionValues(const QValue* reward, const SparseTransitionModel& transMatrix,
+    long state, const QValue* values, double discount, double* q)
+{
+  const long* rowStart = &transMatrix.rowStart[state * NumActs];
+  const int* nextStates = transMatrix.nextStates;
+  const TransProb* probs = transMatrix.probs;
+
+  for (int j = 0; j < NumActs; j++){
+    double currValue = reward[j];
+    for (long k = rowStart[j]; k < rowStart[j + 1]; k++){
+      double prob = probs[k];
+      currValue += discount * prob * values[nextStates[k]];
+    }
+    q[j] = currValue;
+  }
+};
+
+/**
+   Turns the max over \a q into the same (value, action) the strict-greater scan gives:
+   the first action holding the max, and -FLT_MAX with action 0 if nothing beats it.
+*/
+template <int NumActs>
+static inline double firstBest(const double* q, double maxValue, long& bestAction)
+{
+  bestAction = 0;
+  if (!(maxValue > -FLT_MAX))
+    return -FLT_MAX;
+  for (int j = 0; j < NumActs; j++){
+    if (q[j] == maxValue){
+      bestAction = j;
+      break;
+    }
+  }
+  // return the stored value, not the max, so the sign of a zero is preserved
+  return q[bestAction];
+};
+
+template <int NumActs>
+static double scalarBackup(const QValue* reward, const SparseTransitionModel& transMatrix,
+    long state, const QValue* values, double discount, long /*numActions*/, long& bestAction, QValue* qRow)
+{
+  double q[NumActs];
+  actionValues<NumActs>(reward, transMatrix, state, values, discount, q);
+  if (qRow)
+    for (int j = 0; j < NumActs; j++)
+      qRow[j] = (QValue) q[j];
+  double maxValue = q[0];
+  for (int j = 1; j < NumActs; j++)
+    if (q[j] > maxValue)
+      maxValue = q[j];
+  return firstBest<NumActs>(q, maxValue, bestAction);
+};
+
+#ifdef BELLMAN_X86
+template <int NumActs>
+static double sseBackup(const QValue* reward, const SparseTransitionModel& transMatrix,
+    long state, const QValue* values, double discount, long /*numActions*/, long& bestAction, QValue* qRow)
+{
+  double q[NumActs];
+  actionValues<NumActs>(reward, transMatrix, state, values, discount, q);
+  if (qRow)
+    for (int j = 0; j < NumActs; j++)
+      qRow[j] = (QValue) q[j];
+
+  __m128d m = _mm_set1_pd(q[0]);
+  int j = 0;
+  for (; j + 2 <= NumActs; j += 2)
+    m = _mm_max_pd(m, _mm_loadu_pd(q + j));
+  double lanes[2];
+  _mm_storeu_pd(lanes, m);
+  double maxValue = (lanes[0] > lanes[1])? lanes[0] : lanes[1];
+  for (; j < NumActs; j++)
+    if (q[j] > maxValue)
+      maxValue = q[j];
+  return firstBest<NumActs>(q, maxValue, bestAction);
+};
+
+template <int NumActs>
+__attribute__((target("avx2")))
+static double avx2Backup(const QValue* reward, const SparseTransitionModel& transMatrix,
+    long state, const QValue* values, double discount, long /*numActions*/, long& bestAction, QValue* qRow)
+{
+  double q[NumActs];
+  actionValues<NumActs>(reward, transMatrix, state, values, discount, q);
+  if (qRow)
+    for (int j = 0; j < NumActs; j++)
+      qRow[j] = (QValue) q[j];
+
+  __m256d m = _mm256_set1_pd(q[0]);
+  int j = 0;
+  for (; j + 4 <= NumActs; j += 4)
+    m = _mm256_max_pd(m, _mm256_loadu_pd(q + j));
+  __m128d h = _mm_max_pd(_mm256_castpd256_pd128(m), _mm256_extractf128_pd(m, 1));
+  double lanes[2];
+  _mm_storeu_pd(lanes, h);
+  double maxValue = (lanes[0] > lanes[1])? lanes[0] : lanes[1];
+  for (; j < NumActs; j++)
+    if (q[j] > maxValue)
+      maxValue = q[j];
+  return firstBest<NumActs>(q, maxValue, bestAction);
+};
+#endif
+
+BellmanBackup::isaType BellmanBackup::detectISA()
+{
+#ifdef BELLMAN_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return avx2ISA;
+  if (__builtin_cpu_supports("sse2"))
+    return sseISA;
+#endif
+  return scalarISA;
+};
+
+template <int NumActs>
+static BellmanBackupKernel kernelFor(BellmanBackup::isaType isa, const char** name)
+{
+#ifdef BELLMAN_X86
+  if (isa == BellmanBackup::avx2ISA){
+    if (name) *name = "AVX2";
+    return avx2Backup<NumActs>;
+  }
+  if (isa == BellmanBackup::sseISA){
+    if (name) *name = "SSE2";
+    return sseBackup<NumActs>;
+  }
+#endif
+  if (name) *name = "scalar, fixed action count";
+  return scalarBackup<NumActs>;
+};
+
+BellmanBackupKernel BellmanBackup::selectKernel(long numActions, isaType isa, const char** name)
+{
+  // GhostBusters: human has 5 moves plus an optional special act, the assistant 5 or 6
+  switch (numActions){
+  case 25:
+    return kernelFor<25>(isa, name);
+  case 30:
+    return kernelFor<30>(isa, name);
+  case 36:
+    return kernelFor<36>(isa, name);
+  default:
+    if (name) *name = "generic";
+    return genericBackup;
+  }
+};
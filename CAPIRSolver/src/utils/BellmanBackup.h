@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2012 Truong-Huy D. Nguyen.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the GNU Public License v3.0
+ * which accompanies this distribution, and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * 
+ * Contributors:
+ *     Truong-Huy D. Nguyen - initial API and implementation
+ */
+
+
+
+#ifndef __BELLMANBACKUP_H
+#define __BELLMANBACKUP_H
+
+#include "SparseTransitionModel.h"
+
+/**
+   Backs up one state: computes the value of every action from \a values and
+   returns the best one. \a bestAction is the first action reaching it, exactly
+   as the plain strict-greater scan does.
+   @param[in] reward the state's reward row, \a numActions entries
+   @param[out] qRow if not null, receives the value of every action (the Q function row)
+*/
+typedef double (*BellmanBackupKernel)(const QValue* reward, const SparseTransitionModel& transMatrix,
+    long state, const QValue* values, double discount, long numActions, long& bestAction, QValue* qRow);
+
+/**
+   @class BellmanBackup
+   @brief Bellman backup kernels specialized on the number of actions
+   @details The specialized kernels compute all action values of a state into a
+   fixed-size buffer, then take the max with AVX2 or SSE2 depending on what the
+   CPU supports. Action counts without a specialization use the generic scalar kernel.
+*/
+class BellmanBackup
+{
+ public:
+    enum isaType {scalarISA, sseISA, avx2ISA};
+
+    /**
+       The best instruction set the CPU running us supports.
+    */
+    static isaType detectISA();
+
+    /**
+       @return the kernel for \a numActions actions using at most \a isa, falling
+       back to the generic kernel. \a name, if set, receives a description of it.
+    */
+    static BellmanBackupKernel selectKernel(long numActions, isaType isa, const char** name = 0);
+
+    /**
+       Generic scalar kernel, the loop ValueIteration has always used.
+    */
+    static double genericBackup(const QValue* reward, const SparseTransitionModel& transMatrix,
+        long state, const QValue* values, double discount, long numActions, long& bestAction, QValue* qRow);
+};
+
+#endif // __BELLMANBACKUP_H
@@ -13,15 +13,44 @@
 
 #include "Compression.h"
 
+/**
+  Size of the raw and of the compressed chunks the streams hold.
+*/
+const size_t ChunkSize = 65536;
+
 /** Compress a STL string using zlib with given compression level and return
   * the binary data. 
   */
+std::string Compression::compress_string(const std::string& str, int compressionlevel)
+{
+    std::ostringstream outstring;
+    CompressedWriter writer(outstring, compressionlevel);
+    writer.write(str.data(), str.size());
+    writer.finish();
+    return outstring.str();
+}
+
+/** Decompress an STL string using zlib and return the original data. */
+std::string Compression::decompress_string(const std::string& str)
+{
+    CompressedReader reader(str.data(), str.size());
+    std::ostringstream outstring;
+    char block[4096];
+    do {
+        reader.read(block, sizeof(block));
+        outstring.write(block, reader.gcount());
+    } while (reader.good());
 
-#define BUFF_SIZE 524288 // 512K
+    if (reader.bad())
+        throw(std::runtime_error("Exception during zlib decompression"));
+    return outstring.str();
+}
 
-std::string Compression::compress_string(const std::string& str, int compressionlevel)
+// TODO --------------- CompressedWriter
+
+CompressedWriter::Buffer::Buffer(std::ostream& sink, int compressionlevel)
+    : sink(sink), raw(ChunkSize), compressed(ChunkSize), finished(false)
 {
-    z_stream zs;                        // z_stream is zlib's control structure
     memset(&zs, 0, sizeof(zs));
 
     if (compressionlevel < 0)
@@ -30,77 +59,132 @@ std::string Compression::compress_string(const std::string& str, int compression
     if (deflateInit(&zs, compressionlevel) != Z_OK)
         throw(std::runtime_error("deflateInit failed while compressing."));
 
-    zs.next_in = (Bytef*)str.data();
-    zs.avail_in = str.size();           // set the z_stream's input
-
-    int ret;
-    char outbuffer[BUFF_SIZE];
-    std::string outstring;
+    setp(&raw[0], &raw[0] + raw.size());
+}
 
-    // retrieve the compressed bytes blockwise
-    do {
-        zs.next_out = reinterpret_cast<Bytef*>(outbuffer);
-        zs.avail_out = sizeof(outbuffer);
+CompressedWriter::Buffer::~Buffer()
+{
+    deflateEnd(&zs);
+}
 
-        ret = deflate(&zs, Z_FINISH);
+void CompressedWriter::Buffer::deflateChunk(int flush)
+{
+    zs.next_in = reinterpret_cast<Bytef*>(pbase());
+    zs.avail_in = pptr() - pbase();
 
-        if (outstring.size() < zs.total_out) {
-            // append the block to the output string
-            outstring.append(outbuffer,
-                             zs.total_out - outstring.size());
+    // write the compressed bytes blockwise until deflate has consumed the chunk (and, when
+    // finishing, ended the stream)
+    int ret;
+    do {
+        zs.next_out = reinterpret_cast<Bytef*>(&compressed[0]);
+        zs.avail_out = compressed.size();
+
+        ret = deflate(&zs, flush);
+        if (ret == Z_STREAM_ERROR) {
+            std::ostringstream oss;
+            oss << "Exception during zlib compression: (" << ret << ") " << zs.msg;
+            throw(std::runtime_error(oss.str()));
         }
-    } while (ret == Z_OK);
 
-    deflateEnd(&zs);
+        sink.write(&compressed[0], compressed.size() - zs.avail_out);
+    } while (zs.avail_out == 0 || (flush == Z_FINISH && ret != Z_STREAM_END));
 
-    if (ret != Z_STREAM_END) {          // an error occurred that was not EOF
-        std::ostringstream oss;
-        oss << "Exception during zlib compression: (" << ret << ") " << zs.msg;
-        throw(std::runtime_error(oss.str()));
-    }
+    setp(&raw[0], &raw[0] + raw.size());
+}
 
-    return outstring;
+int CompressedWriter::Buffer::overflow(int c)
+{
+    if (finished)
+        return traits_type::eof();
+    deflateChunk(Z_NO_FLUSH);
+    if (c != traits_type::eof()) {
+        *pptr() = c;
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
 }
 
-/** Decompress an STL string using zlib and return the original data. */
-std::string Compression::decompress_string(const std::string& str)
+int CompressedWriter::Buffer::sync()
 {
-    z_stream zs;                        // z_stream is zlib's control structure
-    memset(&zs, 0, sizeof(zs));
+    if (!finished)
+        deflateChunk(Z_NO_FLUSH);
+    return sink.good()? 0 : -1;
+}
 
-    if (inflateInit(&zs) != Z_OK)
-        throw(std::runtime_error("inflateInit failed while decompressing."));
+CompressedWriter::CompressedWriter(std::ostream& sink, int compressionlevel)
+    : std::ostream(0), buffer(sink, compressionlevel)
+{
+    rdbuf(&buffer);
+}
 
-    zs.next_in = (Bytef*)str.data();
-    zs.avail_in = str.size();
+CompressedWriter::~CompressedWriter()
+{
+    rdbuf(0);
+}
 
-    int ret;
-    char outbuffer[BUFF_SIZE];
-    std::string outstring;
+void CompressedWriter::finish()
+{
+    if (buffer.finished)
+        return;
+    buffer.deflateChunk(Z_FINISH);
+    buffer.finished = true;
+    if (!buffer.sink.good())
+        setstate(std::ios::badbit);
+}
 
-    // get the decompressed bytes blockwise using repeated calls to inflate
-    do {
-        zs.next_out = reinterpret_cast<Bytef*>(outbuffer);
-        zs.avail_out = sizeof(outbuffer);
+// TODO --------------- CompressedReader
 
-        ret = inflate(&zs, 0);
+CompressedReader::Buffer::Buffer(const char* data, size_t size)
+    : raw(ChunkSize), ended(false)
+{
+    memset(&zs, 0, sizeof(zs));
 
-        if (outstring.size() < zs.total_out) {
-            outstring.append(outbuffer,
-                             zs.total_out - outstring.size());
-        }
+    if (inflateInit(&zs) != Z_OK)
+        throw(std::runtime_error("inflateInit failed while decompressing."));
 
-    } while (ret == Z_OK);
+    zs.next_in = (Bytef*) data;
+    zs.avail_in = size;
+    setg(&raw[0], &raw[0], &raw[0]);
+}
 
+CompressedReader::Buffer::~Buffer()
+{
     inflateEnd(&zs);
+}
 
-    if (ret != Z_STREAM_END) {          // an error occurred that was not EOF
-        std::ostringstream oss;
-        oss << "Exception during zlib decompression: (" << ret << ") "
-            << zs.msg;
-        throw(std::runtime_error(oss.str()));
+int CompressedReader::Buffer::underflow()
+{
+    if (gptr() < egptr())
+        return traits_type::to_int_type(*gptr());
+    if (ended)
+        return traits_type::eof();
+
+    // inflate until the chunk holds something: a run of input can produce no output
+    zs.next_out = reinterpret_cast<Bytef*>(&raw[0]);
+    zs.avail_out = raw.size();
+    while (zs.avail_out == raw.size()) {
+        int ret = inflate(&zs, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            ended = true;
+            break;
+        }
+        // Z_BUF_ERROR: the input ran out before the end of the stream
+        if (ret != Z_OK) {
+            std::ostringstream oss;
+            oss << "Exception during zlib decompression: (" << ret << ") "
+                << (zs.msg? zs.msg : "truncated");
+            throw(std::runtime_error(oss.str()));
+        }
     }
 
-    return outstring;
+    setg(&raw[0], &raw[0], &raw[0] + (raw.size() - zs.avail_out));
+    if (gptr() == egptr())
+        return traits_type::eof();
+    return traits_type::to_int_type(*gptr());
 }
 
+CompressedReader::CompressedReader(const char* data, size_t size)
+    : std::istream(0), buffer(data, size)
+{
+    rdbuf(&buffer);
+}
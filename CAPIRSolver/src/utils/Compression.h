@@ -22,11 +22,12 @@
 #include <iomanip>
 #include <sstream>
 #include <cstring>
+#include <vector>
 #include "zlib.h"
 
 /**
    @class Compression
-   @brief Class dealing with compressing text files. 
+   @brief Class dealing with compressing text files held in memory. 
    @author Timo Bingmann at http://idlebox.net/about/timo.htt
    @date 05 Sept 2010
 */
@@ -39,4 +40,83 @@ class Compression
     static std::string decompress_string(const std::string& str);
 
 };
+
+/**
+   @class CompressedWriter
+   @brief Output stream that deflates everything written to it into \a sink.
+   @details Raw data is collected in one chunk and deflated into another whenever the
+   first fills up, so a large table can be written value by value with ChunkSize bytes of
+   each in memory. Call finish to end the zlib stream. Errors throw std::runtime_error.
+*/
+class CompressedWriter : public std::ostream
+{
+  public:
+    CompressedWriter(std::ostream& sink, int compressionlevel);
+    ~CompressedWriter();
+
+    /**
+      Deflates what is left and writes the end of the zlib stream to the sink.
+    */
+    void finish();
+
+    /**
+      @return number of bytes written to this stream so far
+    */
+    unsigned long rawSize() const { return buffer.zs.total_in; };
+
+    /**
+      @return number of compressed bytes written to the sink so far
+    */
+    unsigned long compressedSize() const { return buffer.zs.total_out; };
+
+  private:
+    class Buffer : public std::streambuf
+    {
+      public:
+        Buffer(std::ostream& sink, int compressionlevel);
+        ~Buffer();
+        void deflateChunk(int flush);
+
+        std::ostream& sink;
+        z_stream zs;
+        std::vector<char> raw, compressed;
+        bool finished;
+
+      protected:
+        int overflow(int c);
+        int sync();
+    };
+
+    Buffer buffer;
+};
+
+/**
+   @class CompressedReader
+   @brief Input stream that inflates the zlib stream held in memory at \a data.
+   @details Inflates ChunkSize bytes at a time as the stream is read, e.g. from a mapped
+   file, so a large table can be parsed without holding its text. A corrupt or truncated
+   stream sets badbit.
+*/
+class CompressedReader : public std::istream
+{
+  public:
+    CompressedReader(const char* data, size_t size);
+
+  private:
+    class Buffer : public std::streambuf
+    {
+      public:
+        Buffer(const char* data, size_t size);
+        ~Buffer();
+
+        z_stream zs;
+        std::vector<char> raw;
+        bool ended;
+
+      protected:
+        int underflow();
+    };
+
+    Buffer buffer;
+};
 #endif // __COMPRESSION_H
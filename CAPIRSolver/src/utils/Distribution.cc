@@ -87,7 +87,8 @@ long Distribution::multinomialSample(const vector<double>& distrib,
 ;
 
 // max in [startIndex, endIndex]
-long Distribution::getMax(const vector<double>& distrib, long startIndex,
+template <class T>
+static long getMaxIndex(const vector<T>& distrib, long startIndex,
     long endIndex, RandSource *randSource) {
   if (startIndex < 0)
     startIndex = 0;
@@ -121,25 +122,27 @@ long Distribution::getMax(const vector<double>& distrib, long startIndex,
 }
 ;
 
-double Distribution::getMaxValue(const vector<double>& distrib,
-    long startIndex, long endIndex) {
-
-  //assert ( (startIndex <= endIndex) && (startIndex >0) && (endIndex < ((long)distrib.size())) );
-
-  if (startIndex < 0)
-    startIndex = 0;
-  if (endIndex < 0)
-    endIndex = distrib.size() - 1;
+long Distribution::getMax(const vector<double>& distrib, long startIndex,
+    long endIndex, RandSource *randSource) {
+  return getMaxIndex(distrib, startIndex, endIndex, randSource);
+}
+;
 
-  long maxIndex = startIndex;
+long Distribution::getMax(const vector<float>& distrib, long startIndex,
+    long endIndex, RandSource *randSource) {
+  return getMaxIndex(distrib, startIndex, endIndex, randSource);
+}
+;
 
-  for (long i = startIndex + 1; i <= endIndex; i++) {
-    if (distrib[maxIndex] < distrib[i]) {
-      maxIndex = i;
-    }
-  }
+double Distribution::getMaxValue(const vector<double>& distrib,
+    long startIndex, long endIndex) {
+  return distrib[getMaxIndex(distrib, startIndex, endIndex, (RandSource*) 0)];
+}
+;
 
-  return distrib[maxIndex];
+double Distribution::getMaxValue(const vector<float>& distrib,
+    long startIndex, long endIndex) {
+  return distrib[getMaxIndex(distrib, startIndex, endIndex, (RandSource*) 0)];
 }
 ;
 
@@ -47,6 +47,11 @@ class Distribution
     */
     static long getMax(const std::vector<double>& distrib, long startIndex = -1, long endIndex = -1, RandSource *randSource = 0);
     static double getMaxValue(const std::vector<double>& distrib, long startIndex = -1, long endIndex = -1);
+    /**
+      Single precision versions, used on Q function rows when built with SINGLE_PRECISION.
+    */
+    static long getMax(const std::vector<float>& distrib, long startIndex = -1, long endIndex = -1, RandSource *randSource = 0);
+    static double getMaxValue(const std::vector<float>& distrib, long startIndex = -1, long endIndex = -1);
     static double getMinValue(const std::vector<double>& distrib, long startIndex = -1, long endIndex = -1);
     /**
      * @return the index of the pair that has highest probability.
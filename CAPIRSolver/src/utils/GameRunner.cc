@@ -130,7 +130,7 @@ void GameRunner::receiveStateWBelief(int sock, State& state, vector<double>& wBe
 		pugi::xml_node worlds = doc.child("state").child("worlds");
 		wBelief.resize(0);
 		state.mazeProperties.resize(0);
-		std::vector<long> stateProperties;
+		PropertyVector stateProperties;
 		for(pugi::xml_node world = worlds.first_child(); world; world = world.next_sibling()){
 			// belief
 			wBelief.push_back(world.attribute("belief").as_double());
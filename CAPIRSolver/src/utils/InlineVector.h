@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2012 Truong-Huy D. Nguyen.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the GNU Public License v3.0
+ * which accompanies this distribution, and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * 
+ * Contributors:
+ *     Truong-Huy D. Nguyen - initial API and implementation
+ */
+
+
+
+#ifndef __INLINEVECTOR_H
+#define __INLINEVECTOR_H
+
+#include <cstddef>
+
+/**
+  @class InlineVector
+  @brief Small vector that keeps up to \a N elements inline and only allocates beyond that.
+  @details Supports the part of the std::vector interface the state structs use (size,
+  empty, resize, push_back, pop_back, clear, indexing and iteration). The inline buffer
+  and the heap pointer share storage, so a vector of \a N ints costs 4 * N + 4 bytes
+  (rounded up to 8), and copying one that fits inline involves no heap traffic.
+  \a T must be a plain value type.
+*/
+template<class T, unsigned N>
+class InlineVector
+{
+public:
+  typedef T value_type;
+  typedef T* iterator;
+  typedef const T* const_iterator;
+
+  InlineVector() : count(0), capacity(N) {};
+
+  InlineVector(const InlineVector& o) : count(0), capacity(N)
+  {
+    assign(o);
+  };
+
+  ~InlineVector()
+  {
+    if (onHeap())
+      delete [] storage.heap;
+  };
+
+  InlineVector& operator=(const InlineVector& o)
+  {
+    if (this != &o)
+      assign(o);
+    return *this;
+  };
+
+  inline size_t size() const { return count; };
+  inline bool empty() const { return count == 0; };
+  inline void clear() { count = 0; };
+
+  inline T& operator[](size_t i) { return data()[i]; };
+  inline const T& operator[](size_t i) const { return data()[i]; };
+
+  inline iterator begin() { return data(); };
+  inline iterator end() { return data() + count; };
+  inline const_iterator begin() const { return data(); };
+  inline const_iterator end() const { return data() + count; };
+
+  void reserve(size_t n)
+  {
+    if (n <= capacity)
+      return;
+    T* grown = new T[n];
+    T* old = data();
+    for (size_t i = 0; i < count; i++)
+      grown[i] = old[i];
+    if (onHeap())
+      delete [] storage.heap;
+    storage.heap = grown;
+    capacity = (unsigned short) n;
+  };
+
+  void resize(size_t n, const T& value = T())
+  {
+    reserve(n);
+    T* d = data();
+    for (size_t i = count; i < n; i++)
+      d[i] = value;
+    count = (unsigned short) n;
+  };
+
+  inline void push_back(const T& value)
+  {
+    if (count == capacity)
+      reserve(2 * capacity);
+    data()[count++] = value;
+  };
+
+  inline void pop_back() { count--; };
+
+  bool operator==(const InlineVector& o) const
+  {
+    if (count != o.count)
+      return false;
+    const T* d = data();
+    const T* od = o.data();
+    for (size_t i = 0; i < count; i++)
+      if (!(d[i] == od[i]))
+        return false;
+    return true;
+  };
+
+  inline bool operator!=(const InlineVector& o) const { return !(*this == o); };
+
+private:
+  union {
+    T inlineData[N];
+    T* heap;
+  } storage;
+  unsigned short count;
+  unsigned short capacity;
+
+  inline bool onHeap() const { return capacity > N; };
+  inline T* data() { return onHeap()? storage.heap : storage.inlineData; };
+  inline const T* data() const { return onHeap()? storage.heap : storage.inlineData; };
+
+  void assign(const InlineVector& o)
+  {
+    count = 0;
+    reserve(o.count);
+    T* d = data();
+    const T* od = o.data();
+    for (size_t i = 0; i < o.count; i++)
+      d[i] = od[i];
+    count = o.count;
+  };
+};
+
+#endif // __INLINEVECTOR_H
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2012 Truong-Huy D. Nguyen.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the GNU Public License v3.0
+ * which accompanies this distribution, and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ *
+ * Contributors:
+ *     Truong-Huy D. Nguyen - initial API and implementation
+ */
+
+
+
+#include "LRTDP.h"
+#include "Distribution.h"
+#include <cfloat>
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+
+/**
+   Longest trial. Discounted problems need not reach a terminal state, so trials are
+   cut off and left to the labeling to finish.
+*/
+const unsigned MaxTrialLength = 1000;
+
+void LRTDP::addState(long state)
+{
+  while ((long) values.size() <= state){
+    long s = values.size();
+    bool terminal = model.isTerminal(s);
+    values.push_back((QValue) (terminal? 0 : initialValue));
+    solved.push_back(terminal);
+    firstRow.push_back(-1);
+    marked.push_back(0);
+  }
+};
+
+void LRTDP::expand(long state)
+{
+  vector<QValue> rewards;
+  vector<sparseStateBelief> next;
+  model.expand(state, rewards, next);
+
+  firstRow[state] = rowRewards.size();
+  for (long j = 0; j < numActions; j++){
+    rowRewards.push_back(rewards[j]);
+    for (unsigned k = 0; k < next[j].size(); k++){
+      addState(next[j][k].first);
+      nextStates.push_back(next[j][k].first);
+      probs.push_back((TransProb) next[j][k].second);
+    }
+    rowEnds.push_back(nextStates.size());
+  }
+  numExpanded++;
+};
+
+double LRTDP::qValue(long row)
+{
+  long begin = (row == 0)? 0 : rowEnds[row - 1];
+  double currValue = rowRewards[row];
+  for (long k = begin; k < rowEnds[row]; k++)
+    currValue += discount * probs[k] * values[nextStates[k]];
+  return currValue;
+};
+
+long LRTDP::greedyAction(long state, double& bestValue)
+{
+  if (firstRow[state] < 0)
+    expand(state);
+
+  long bestAction = 0;
+  bestValue = -FLT_MAX;
+  for (long j = 0; j < numActions; j++){
+    double currValue = qValue(firstRow[state] + j);
+    if (currValue > bestValue){
+      bestValue = currValue;
+      bestAction = j;
+    }
+  }
+  return bestAction;
+};
+
+long LRTDP::update(long state)
+{
+  double bestValue;
+  long bestAction = greedyAction(state, bestValue);
+  values[state] = (QValue) bestValue;
+  numBackups++;
+  return bestAction;
+};
+
+long LRTDP::sampleNext(long state, long action)
+{
+  long row = firstRow[state] + action;
+  long begin = (row == 0)? 0 : rowEnds[row - 1];
+  sampleRow.resize(0);
+  for (long k = begin; k < rowEnds[row]; k++)
+    sampleRow.push_back(make_pair((long) nextStates[k], (double) probs[k]));
+  return sampleRow[Distribution::sampleLongDouble(sampleRow, randSource)].first;
+};
+
+void LRTDP::trial(long start, double targetPrecision)
+{
+  vector<long> visited;
+  long state = start;
+  while (!solved[state]){
+    visited.push_back(state);
+    if (visited.size() >= MaxTrialLength)
+      break;
+    long action = update(state);
+    state = sampleNext(state, action);
+  }
+
+  while (!visited.empty()){
+    state = visited.back();
+    visited.pop_back();
+    if (!checkSolved(state, targetPrecision))
+      break;
+  }
+};
+
+bool LRTDP::checkSolved(long state, double targetPrecision)
+{
+  bool allConsistent = true;
+  vector<long> open, closed;
+  if (!solved[state]){
+    open.push_back(state);
+    marked[state] = 1;
+  }
+
+  // 1. Search the greedy envelope of state, stopping at states that are still off
+  while (!open.empty()){
+    long s = open.back();
+    open.pop_back();
+    closed.push_back(s);
+
+    double bestValue;
+    long bestAction = greedyAction(s, bestValue);
+    if (fabs(bestValue - values[s]) > targetPrecision){
+      allConsistent = false;
+      continue;
+    }
+
+    long row = firstRow[s] + bestAction;
+    for (long k = (row == 0)? 0 : rowEnds[row - 1]; k < rowEnds[row]; k++){
+      long next = nextStates[k];
+      if (!solved[next] && !marked[next]){
+        marked[next] = 1;
+        open.push_back(next);
+      }
+    }
+  }
+
+  // 2. Label the whole envelope, or back it up in reverse order of discovery
+  if (allConsistent){
+    for (unsigned i = 0; i < closed.size(); i++)
+      solved[closed[i]] = 1;
+  }
+  else {
+    for (long i = closed.size() - 1; i >= 0; i--)
+      update(closed[i]);
+  }
+  for (unsigned i = 0; i < closed.size(); i++)
+    marked[closed[i]] = 0;
+
+  return allConsistent;
+};
+
+void LRTDP::solve(const std::vector<long>& starts, double targetPrecision, long maxTrials, long displayInterval)
+{
+  for (unsigned i = 0; i < starts.size(); i++)
+    addState(starts[i]);
+
+  converged = false;
+  while (!converged && (numTrials < maxTrials)){
+    converged = true;
+    for (unsigned i = 0; i < starts.size(); i++){
+      if (solved[starts[i]])
+        continue;
+      converged = false;
+      trial(starts[i], targetPrecision);
+      numTrials++;
+      if ((displayInterval > 0) && (numTrials % (1000 * displayInterval) == 0))
+        cout << "Trial " << numTrials << ": " << numExpanded << " states expanded, "
+             << values.size() << " seen" << endl;
+    }
+  }
+
+  converged = true;
+  for (unsigned i = 0; i < starts.size(); i++)
+    converged = converged && solved[starts[i]];
+};
+
+void LRTDP::getQValues(long state, std::vector<QValue>& qValues)
+{
+  qValues.resize(numActions);
+  for (long j = 0; j < numActions; j++)
+    qValues[j] = (QValue) qValue(firstRow[state] + j);
+};
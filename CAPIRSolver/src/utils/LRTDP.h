@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2012 Truong-Huy D. Nguyen.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the GNU Public License v3.0
+ * which accompanies this distribution, and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ *
+ * Contributors:
+ *     Truong-Huy D. Nguyen - initial API and implementation
+ */
+
+
+
+#ifndef __LRTDP_H
+#define __LRTDP_H
+
+#include <vector>
+#include "Utilities.h"
+#include "Precision.h"
+#include "RandSource.h"
+
+/**
+   @class LRTDP
+   @brief Labeled real-time dynamic programming for MDPs that are never enumerated
+   @details States are pulled from a generative Model as trials reach them, so only
+   states on the greedy envelope of the start states are ever expanded. Each trial
+   follows the greedy policy from a start state, backing up the states it visits and
+   sampling successors, until it reaches a state labeled solved. On the way back the
+   visited states are checked: a state is labeled solved once every state its greedy
+   policy can reach has a residual within targetPrecision. Values start at
+   \a initialValue, which must be an upper bound of the optimal values (rewards are
+   maximized) for the greedy policy to be optimal once the start states are solved.
+   The expansions are cached, so each state asks the model only once. Successors are
+   sampled from \a randSource, so a seeded source makes the trials reproducible.
+*/
+class LRTDP
+{
+ public:
+    /**
+       Generative model the solver pulls states from. States are indexed from 0 as the
+       model discovers them.
+    */
+    class Model
+    {
+     public:
+      virtual ~Model() {};
+
+      /**
+         Fills the expected reward \a rewards[a] and the next state distribution
+         \a next[a] of every action \a a in \a state. Next states may be new indices.
+      */
+      virtual void expand(long state, std::vector<QValue>& rewards, std::vector<sparseStateBelief>& next) = 0;
+
+      /**
+         @return true if \a state is absorbing with value 0
+      */
+      virtual bool isTerminal(long state) = 0;
+    };
+
+    LRTDP(Model& model, RandSource& randSource, long numActions, double discount, double initialValue): numTrials(0), numBackups(0), numExpanded(0), converged(false), model(model), randSource(randSource), numActions(numActions), discount(discount), initialValue(initialValue) {};
+
+    /**
+       Runs trials from \a starts until they are all labeled solved or \a maxTrials
+       trials have been run.
+    */
+    void solve(const std::vector<long>& starts, double targetPrecision, long maxTrials, long displayInterval);
+
+    /**
+       @return true if \a state was expanded, i.e. its Q values are known
+    */
+    bool isExpanded(long state) const { return (state < (long) firstRow.size()) && (firstRow[state] >= 0); };
+
+    /**
+       Q values of expanded \a state under the current values, \a numActions of them.
+    */
+    void getQValues(long state, std::vector<QValue>& qValues);
+
+    /**
+       Number of states seen so far, expanded or not.
+    */
+    long getNumStates() const { return values.size(); };
+
+    long numTrials, numBackups, numExpanded;
+
+    /**
+       All start states were labeled solved by the last call to solve.
+    */
+    bool converged;
+
+ private:
+    Model& model;
+    RandSource& randSource;
+    long numActions;
+    double discount;
+    double initialValue;
+
+    /**
+       Per state: current value, solved label, and first cached row (-1 if not expanded).
+    */
+    std::vector<QValue> values;
+    std::vector<char> solved;
+    std::vector<long> firstRow;
+
+    /**
+       Cached expansions, one row per (expanded state, action): reward, and the end of the
+       row's entries in nextStates and probs.
+    */
+    std::vector<QValue> rowRewards;
+    std::vector<long> rowEnds;
+    std::vector<int> nextStates;
+    std::vector<TransProb> probs;
+
+    /**
+       Scratch flags for checkSolved, always all 0 between calls.
+    */
+    std::vector<char> marked;
+
+    /**
+       Scratch next state distribution for sampleNext.
+    */
+    sparseStateBelief sampleRow;
+
+    void addState(long state);
+    void expand(long state);
+    double qValue(long row);
+    /**
+       Backs up \a state. @return its greedy action
+    */
+    long update(long state);
+    /**
+       Greedy action and its Q value, expanding \a state if needed.
+    */
+    long greedyAction(long state, double& bestValue);
+    long sampleNext(long state, long action);
+    void trial(long start, double targetPrecision);
+    bool checkSolved(long state, double targetPrecision);
+};
+
+#endif // __LRTDP_H
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2012 Truong-Huy D. Nguyen.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the GNU Public License v3.0
+ * which accompanies this distribution, and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * 
+ * Contributors:
+ *     Truong-Huy D. Nguyen - initial API and implementation
+ */
+
+
+
+#include "ModifiedPolicyIteration.h"
+#include <cfloat>
+#include <cmath>
+
+using namespace std;
+
+void ModifiedPolicyIteration::doPolicyIteration(SparseTransitionModel& transMatrix, double targetPrecision, long /*displayInterval*/)
+{
+  if ((long) initialValues.size() == numStates)
+    values = initialValues;
+  else
+    values.assign(numStates, 0);
+  actions.assign(numStates, 0);
+  numSweeps = numBackups = numEvalBackups = 0;
+
+  vector<QValue> improved(numStates, 0);
+  double currChange = FLT_MAX;
+
+  while (currChange > targetPrecision){
+    // 1. Greedy improvement: improved = T values, actions = greedy policy
+    currChange = 0;
+    for (long i = 0; i < numStates; i++){
+      double bestValue = -FLT_MAX;
+      long bestAction = 0;
+      for (long j = 0; j < numActions; j++){
+        double currValue = transMatrix.reward(i, j);
+        for (long k = transMatrix.rowBegin(i, j); k < transMatrix.rowEnd(i, j); k++)
+          currValue += discount * transMatrix.probs[k] * values[transMatrix.nextStates[k]];
+        if (currValue > bestValue){
+          bestValue = currValue;
+          bestAction = j;
+        }
+      }
+      improved[i] = (QValue) bestValue;
+      actions[i] = bestAction;
+      if (fabs(improved[i] - values[i]) > currChange)
+        currChange = fabs(improved[i] - values[i]);
+    }
+    values.swap(improved);
+    numSweeps++;
+    numBackups += numStates;
+
+    if (currChange <= targetPrecision)
+      break;
+
+    // 2. Partial evaluation of the greedy policy, in place
+    for (long e = 0; e < evalSweeps; e++){
+      for (long i = 0; i < numStates; i++){
+        long j = actions[i];
+        double currValue = transMatrix.reward(i, j);
+        for (long k = transMatrix.rowBegin(i, j); k < transMatrix.rowEnd(i, j); k++)
+          currValue += discount * transMatrix.probs[k] * values[transMatrix.nextStates[k]];
+        values[i] = (QValue) currValue;
+      }
+      numEvalBackups += numStates;
+    }
+  }
+};
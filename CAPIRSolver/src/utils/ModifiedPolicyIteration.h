@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2012 Truong-Huy D. Nguyen.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the GNU Public License v3.0
+ * which accompanies this distribution, and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * 
+ * Contributors:
+ *     Truong-Huy D. Nguyen - initial API and implementation
+ */
+
+
+
+#ifndef __MODIFIEDPOLICYITERATION_H
+#define __MODIFIEDPOLICYITERATION_H
+
+#include <vector>
+#include "SparseTransitionModel.h"
+
+/**
+   @class ModifiedPolicyIteration
+   @brief Modified policy iteration for MDPs
+   @details Alternates one greedy improvement sweep (a full Bellman backup over
+   all actions) with \a evalSweeps in-place evaluation sweeps of the greedy policy,
+   which only look at one action per state. Stops when the improvement sweep
+   changes no value by more than targetPrecision, the same test ValueIteration uses.
+   Takes the same inputs and fills the same \a values and \a actions as ValueIteration.
+*/
+class ModifiedPolicyIteration
+{
+ public:
+    ModifiedPolicyIteration(long numStates, long numActions, double discount, long evalSweeps): numSweeps(0), numBackups(0), numEvalBackups(0), numStates(numStates), numActions(numActions), discount(discount), evalSweeps(evalSweeps) {};
+
+    /**
+       Start from \a init instead of all zeros (warm start). Ignored if the size does not match.
+    */
+    void setInitialValues(const std::vector<QValue>& init) { initialValues = init; };
+
+    void doPolicyIteration(SparseTransitionModel& transMatrix, double targetPrecision, long displayInterval);
+
+    std::vector<QValue> values;
+    std::vector<int> actions;
+
+    /**
+       Number of improvement sweeps performed by the last call to doPolicyIteration.
+    */
+    long numSweeps;
+
+    /**
+       Number of full (all actions) backups and of single-action evaluation backups.
+    */
+    long numBackups, numEvalBackups;
+
+ private:
+    long numStates;
+    long numActions;
+    double discount;
+    long evalSweeps;
+    std::vector<QValue> initialValues;
+};
+
+#endif // __MODIFIEDPOLICYITERATION_H
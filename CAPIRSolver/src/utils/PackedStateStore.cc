@@ -0,0 +1,392 @@
+/*
+ * Copyright (c) 2012 Truong-Huy D. Nguyen.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the GNU Public License v3.0
+ * which accompanies this distribution, and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ *
+ * Contributors:
+ *     Truong-Huy D. Nguyen - initial API and implementation
+ */
+
+
+
+#include "PackedStateStore.h"
+#include <iostream>
+#include <cstdlib>
+
+using namespace std;
+
+/**
+  Widest key supported, in 64-bit words. Lookups pack the queried state on the stack.
+*/
+const long MaxKeyWords = 4;
+
+/**
+  @return number of bits needed for \a count distinct codes
+*/
+static int bitsFor(uint64_t count)
+{
+  int bits = 0;
+  while (bits < 64 && ((uint64_t) 1 << bits) < count)
+    bits++;
+  return bits;
+};
+
+static void writeBits(uint64_t* key, long pos, int bits, uint64_t value)
+{
+  if (bits == 0)
+    return;
+  long word = pos >> 6;
+  int offset = pos & 63;
+  key[word] |= value << offset;
+  if (offset + bits > 64)
+    key[word + 1] |= value >> (64 - offset);
+};
+
+static uint64_t readBits(const uint64_t* key, long pos, int bits)
+{
+  if (bits == 0)
+    return 0;
+  long word = pos >> 6;
+  int offset = pos & 63;
+  uint64_t value = key[word] >> offset;
+  if (offset + bits > 64)
+    value |= key[word + 1] << (64 - offset);
+  if (bits < 64)
+    value &= ((uint64_t) 1 << bits) - 1;
+  return value;
+};
+
+PropertyVector& PackedStateStore::group(AbstractState& state, int g)
+{
+  switch (g){
+  case 0:
+    return state.playerProperties[humanIndex];
+  case 1:
+    return state.playerProperties[aiIndex];
+  case 2:
+    return state.monsterProperties;
+  default:
+    return state.specialLocationProperties;
+  }
+};
+
+const PropertyVector& PackedStateStore::group(const AbstractState& state, int g)
+{
+  return group(const_cast<AbstractState&>(state), g);
+};
+
+// TODO --------------- Layout
+
+bool PackedStateStore::Layout::covers(const AbstractState& state) const
+{
+  for (int g = 0; g < 4; g++){
+    const PropertyVector& props = group(state, g);
+    if (props.size() > low[g].size())
+      return false;
+    for (unsigned j = 0; j < props.size(); j++){
+      if (props[j] == TermState)
+        continue;
+      if (props[j] < low[g][j] || props[j] > high[g][j])
+        return false;
+    }
+  }
+  return true;
+};
+
+void PackedStateStore::Layout::widen(const AbstractState& state)
+{
+  long bits = 0;
+  for (int g = 0; g < 4; g++){
+    const PropertyVector& props = group(state, g);
+    if (props.size() > low[g].size()){
+      low[g].resize(props.size(), INT_MAX);
+      high[g].resize(props.size(), INT_MIN);
+      width[g].resize(props.size(), 0);
+    }
+    for (unsigned j = 0; j < props.size(); j++){
+      if (props[j] == TermState)
+        continue;
+      if (props[j] < low[g][j])
+        low[g][j] = props[j];
+      if (props[j] > high[g][j])
+        high[g][j] = props[j];
+    }
+
+    // Widths round up to whole bits; let high cover every value they can code, so a
+    // slot is only widened again once its width has to grow
+    lengthWidth[g] = bitsFor(low[g].size() + 1);
+    bits += lengthWidth[g];
+    for (unsigned j = 0; j < low[g].size(); j++){
+      if (low[g][j] > high[g][j])
+        continue;
+      width[g][j] = bitsFor((uint64_t) ((int64_t) high[g][j] - low[g][j]) + 2);
+      int64_t top = (int64_t) low[g][j] + (((int64_t) 1 << width[g][j]) - 2);
+      high[g][j] = (top > INT_MAX)? INT_MAX : (PropertyValue) top;
+      bits += width[g][j];
+    }
+  }
+
+  numWords = (bits + 63) / 64;
+  if (numWords == 0)
+    numWords = 1;
+  if (numWords > MaxKeyWords){
+    cerr << "PackedStateStore: states need " << bits << " bits, more than "
+         << 64 * MaxKeyWords << "\n";
+    exit(EXIT_FAILURE);
+  }
+};
+
+void PackedStateStore::Layout::encode(const AbstractState& state, uint64_t* key) const
+{
+  for (long w = 0; w < numWords; w++)
+    key[w] = 0;
+
+  long pos = 0;
+  for (int g = 0; g < 4; g++){
+    const PropertyVector& props = group(state, g);
+    writeBits(key, pos, lengthWidth[g], props.size());
+    pos += lengthWidth[g];
+    for (unsigned j = 0; j < low[g].size(); j++){
+      if (j < props.size() && props[j] != TermState)
+        writeBits(key, pos, width[g][j], (uint64_t) ((int64_t) props[j] - low[g][j]) + 1);
+      pos += width[g][j];
+    }
+  }
+};
+
+void PackedStateStore::Layout::decode(const uint64_t* key, AbstractState& state) const
+{
+  long pos = 0;
+  for (int g = 0; g < 4; g++){
+    PropertyVector& props = group(state, g);
+    unsigned length = readBits(key, pos, lengthWidth[g]);
+    pos += lengthWidth[g];
+    props.resize(0);
+    props.resize(length);
+    for (unsigned j = 0; j < low[g].size(); j++){
+      if (j < length){
+        uint64_t code = readBits(key, pos, width[g][j]);
+        props[j] = (code == 0)? (PropertyValue) TermState
+                              : (PropertyValue) ((int64_t) low[g][j] + (int64_t) code - 1);
+      }
+      pos += width[g][j];
+    }
+  }
+};
+
+// TODO --------------- Store
+
+long PackedStateStore::append(const AbstractState& state)
+{
+  if (!layout.covers(state))
+    relayout(state);
+
+  long index = numStates;
+  keys.resize((index + 1) * layout.numWords);
+  layout.encode(state, &keys[index * layout.numWords]);
+  numStates++;
+
+  if (indexed){
+    if (2 * numStates > (long) table.size())
+      fillTable();
+    else
+      place(index);
+  }
+  return index;
+};
+
+long PackedStateStore::insert(const AbstractState& state)
+{
+  if (!indexed)
+    buildIndex();
+  long index = find(state);
+  return (index >= 0)? index : append(state);
+};
+
+long PackedStateStore::find(const AbstractState& state) const
+{
+  if (!indexed || !layout.covers(state))
+    return -1;
+  uint64_t k[MaxKeyWords];
+  layout.encode(state, k);
+  return lookup(k);
+};
+
+void PackedStateStore::get(long index, AbstractState& state) const
+{
+  layout.decode(key(index), state);
+};
+
+void PackedStateStore::buildIndex()
+{
+  compact();
+  indexed = true;
+  fillTable();
+};
+
+void PackedStateStore::keep(const vector<char>& keep)
+{
+  long words = layout.numWords;
+  long kept = 0;
+  for (long s = 0; s < numStates; s++){
+    if (!keep[s])
+      continue;
+    if (kept != s)
+      for (long w = 0; w < words; w++)
+        keys[kept * words + w] = keys[s * words + w];
+    kept++;
+  }
+  numStates = kept;
+  keys.resize(kept * words);
+  compact();
+  if (indexed)
+    fillTable();
+};
+
+void PackedStateStore::relayout(const AbstractState& state)
+{
+  Layout wider = layout;
+  wider.widen(state);
+
+  vector<uint64_t> packed(numStates * wider.numWords);
+  AbstractState temp;
+  for (long s = 0; s < numStates; s++){
+    layout.decode(key(s), temp);
+    wider.encode(temp, &packed[s * wider.numWords]);
+  }
+  keys.swap(packed);
+  layout = wider;
+
+  if (indexed)
+    fillTable();
+};
+
+// TODO --------------- Serialization
+
+template<class T>
+static void writeValue(ostream& out, T value)
+{
+  out.write((const char*) &value, sizeof(T));
+};
+
+template<class T>
+static bool readValue(istream& in, T& value)
+{
+  in.read((char*) &value, sizeof(T));
+  return !in.fail();
+};
+
+void PackedStateStore::write(ostream& out) const
+{
+  writeValue<int64_t>(out, numStates);
+  writeValue<int64_t>(out, layout.numWords);
+  for (int g = 0; g < 4; g++){
+    writeValue<int32_t>(out, layout.lengthWidth[g]);
+    writeValue<int32_t>(out, layout.low[g].size());
+    for (unsigned j = 0; j < layout.low[g].size(); j++){
+      writeValue<int32_t>(out, layout.low[g][j]);
+      writeValue<int32_t>(out, layout.high[g][j]);
+      writeValue<int32_t>(out, layout.width[g][j]);
+    }
+  }
+  if (numStates > 0)
+    out.write((const char*) &keys[0], numStates * layout.numWords * sizeof(uint64_t));
+};
+
+bool PackedStateStore::read(istream& in)
+{
+  *this = PackedStateStore();
+
+  // 1. Layout, checked so that no field runs past the keys
+  int64_t states, words;
+  if (!readValue(in, states) || !readValue(in, words) || states < 0
+      || words < 1 || words > MaxKeyWords)
+    return false;
+  Layout stored;
+  stored.numWords = words;
+  long bits = 0;
+  for (int g = 0; g < 4; g++){
+    int32_t lengthWidth, slots;
+    if (!readValue(in, lengthWidth) || !readValue(in, slots) || slots < 0
+        || lengthWidth < bitsFor(slots + 1) || lengthWidth > 32)
+      return false;
+    stored.lengthWidth[g] = lengthWidth;
+    bits += lengthWidth;
+    stored.low[g].resize(slots);
+    stored.high[g].resize(slots);
+    stored.width[g].resize(slots);
+    for (int32_t j = 0; j < slots; j++){
+      int32_t low, high, width;
+      if (!readValue(in, low) || !readValue(in, high) || !readValue(in, width)
+          || width < 0 || width > 33)
+        return false;
+      stored.low[g][j] = low;
+      stored.high[g][j] = high;
+      stored.width[g][j] = width;
+      bits += width;
+    }
+  }
+  if (bits > 64 * words)
+    return false;
+
+  // 2. Keys
+  vector<uint64_t> stateKeys(states * words);
+  if (states > 0){
+    in.read((char*) &stateKeys[0], stateKeys.size() * sizeof(uint64_t));
+    if (in.fail())
+      return false;
+  }
+
+  layout = stored;
+  keys.swap(stateKeys);
+  numStates = states;
+  return true;
+};
+
+// TODO --------------- Lookup table
+
+unsigned long PackedStateStore::slotOf(const uint64_t* k) const
+{
+  uint64_t h = 0;
+  for (long w = 0; w < layout.numWords; w++)
+    h = (h ^ k[w]) * 0x9E3779B97F4A7C15ULL;
+  h ^= h >> 32;
+  return (unsigned long) h & (table.size() - 1);
+};
+
+long PackedStateStore::lookup(const uint64_t* k) const
+{
+  long words = layout.numWords;
+  unsigned long mask = table.size() - 1;
+  for (unsigned long slot = slotOf(k); table[slot] >= 0; slot = (slot + 1) & mask){
+    const uint64_t* other = key(table[slot]);
+    long w = 0;
+    while (w < words && other[w] == k[w])
+      w++;
+    if (w == words)
+      return table[slot];
+  }
+  return -1;
+};
+
+void PackedStateStore::place(long index)
+{
+  unsigned long mask = table.size() - 1;
+  unsigned long slot = slotOf(key(index));
+  while (table[slot] >= 0)
+    slot = (slot + 1) & mask;
+  table[slot] = index;
+};
+
+void PackedStateStore::fillTable()
+{
+  // power of two, at most half full
+  unsigned long size = 16;
+  while (size < (unsigned long) (2 * numStates))
+    size *= 2;
+  vector<int>(size, -1).swap(table);
+  for (long s = 0; s < numStates; s++)
+    place(s);
+};
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2012 Truong-Huy D. Nguyen.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the GNU Public License v3.0
+ * which accompanies this distribution, and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ *
+ * Contributors:
+ *     Truong-Huy D. Nguyen - initial API and implementation
+ */
+
+
+
+#ifndef __PACKEDSTATESTORE_H
+#define __PACKEDSTATESTORE_H
+
+#include <vector>
+#include <iostream>
+#include <stdint.h>
+#include "Utilities.h"
+
+/**
+  @class PackedStateStore
+  @brief Index <-> AbstractState map that keeps every state as a bit-packed key.
+  @details Each property slot of the four property groups (human, assistant, monster,
+  special location) gets just enough bits for the range of values the stored states
+  take there, and each group a few bits for its length, so a state usually packs into
+  one 64-bit word (two for the larger raw layouts). Keys are kept in index order in one
+  array; an open-addressing table of indices finds the index of a state. The layout
+  widens, re-packing the stored keys, whenever a new state has a value outside it.
+  TermState gets code 0 in every slot, so the terminal dummy does not stretch the ranges.
+*/
+class PackedStateStore
+{
+public:
+  PackedStateStore() : numStates(0), indexed(false) {};
+
+  /**
+    @return number of states stored
+  */
+  long size() const { return numStates; };
+
+  /**
+    Appends \a state as the next index without looking it up.
+    @return its index
+  */
+  long append(const AbstractState& state);
+
+  /**
+    Looks \a state up, appending it if it is not stored yet. Builds the lookup table first
+    if needed.
+    @return its index
+  */
+  long insert(const AbstractState& state);
+
+  /**
+    @return index of \a state, or -1 if it is not stored. buildIndex must have been called.
+  */
+  long find(const AbstractState& state) const;
+
+  /**
+    Unpacks the state at \a index into \a state.
+  */
+  void get(long index, AbstractState& state) const;
+
+  /**
+    Builds the state -> index table. Appending until all states are in and then building
+    the table once is cheaper than inserting; until then only \a get works. Of two equal
+    states the first one is found.
+  */
+  void buildIndex();
+
+  /**
+    Releases the spare capacity the appends left behind.
+  */
+  void compact() { std::vector<uint64_t>(keys).swap(keys); };
+
+  /**
+    Drops every state \a s with !\a keep[s], the others keep their order.
+  */
+  void keep(const std::vector<char>& keep);
+
+  /**
+    Writes the layout and the keys to \a out, in native byte order. The lookup table is
+    not written.
+  */
+  void write(std::ostream& out) const;
+
+  /**
+    Replaces the contents with what \a write wrote. Call buildIndex before looking
+    states up.
+    @return false if \a in is short or does not hold a valid layout; the store is then empty
+  */
+  bool read(std::istream& in);
+
+  /**
+    @return number of 64-bit words per key
+  */
+  long keyWords() const { return layout.numWords; };
+
+  /**
+    Approximate number of bytes held by the keys and the lookup table.
+  */
+  long memoryUsage() const { return keys.capacity() * sizeof(uint64_t) + table.capacity() * sizeof(int); };
+
+private:
+  /**
+    Bit layout of the keys: per group, the width of its length field and, per slot, the
+    width of its codes (value - low + 1, 0 for TermState) and the range [low, high] of
+    values they cover. Slots no state has a value in yet have low > high.
+  */
+  struct Layout
+  {
+    Layout() : numWords(1) { for (int g = 0; g < 4; g++) lengthWidth[g] = 0; };
+
+    int lengthWidth[4];
+    std::vector<PropertyValue> low[4];
+    std::vector<PropertyValue> high[4];
+    std::vector<int> width[4];
+    long numWords;
+
+    bool covers(const AbstractState& state) const;
+    void widen(const AbstractState& state);
+    void encode(const AbstractState& state, uint64_t* key) const;
+    void decode(const uint64_t* key, AbstractState& state) const;
+  };
+
+  Layout layout;
+  long numStates;
+
+  /**
+    numStates keys of layout.numWords words each, in index order.
+  */
+  std::vector<uint64_t> keys;
+
+  /**
+    Open-addressing (linear probing) table of state indices, -1 for empty slots, at most
+    half full. Only kept up once buildIndex has been called.
+  */
+  bool indexed;
+  std::vector<int> table;
+
+  const uint64_t* key(long index) const { return &keys[index * layout.numWords]; };
+  unsigned long slotOf(const uint64_t* k) const;
+  /**
+    @return index of the state packed in \a k, or -1
+  */
+  long lookup(const uint64_t* k) const;
+  /**
+    Puts \a index in the first free slot of its probe sequence.
+  */
+  void place(long index);
+  /**
+    Rebuilds the table for numStates states.
+  */
+  void fillTable();
+  /**
+    Re-packs every key under a layout widened to \a state.
+  */
+  void relayout(const AbstractState& state);
+
+  static PropertyVector& group(AbstractState& state, int g);
+  static const PropertyVector& group(const AbstractState& state, int g);
+};
+
+#endif // __PACKEDSTATESTORE_H
@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2012 Truong-Huy D. Nguyen.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the GNU Public License v3.0
+ * which accompanies this distribution, and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * 
+ * Contributors:
+ *     Truong-Huy D. Nguyen - initial API and implementation
+ */
+
+
+
+#ifndef __PRECISION_H
+#define __PRECISION_H
+
+/**
+   Storage types for values, Q values, rewards and transition probabilities.
+   Build with -DSINGLE_PRECISION to store them as float, which halves the
+   resident size of the solver's tables. Backups still accumulate in double.
+*/
+#ifdef SINGLE_PRECISION
+typedef float QValue;
+typedef float TransProb;
+#else
+typedef double QValue;
+typedef double TransProb;
+#endif
+
+#endif // __PRECISION_H
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2012 Truong-Huy D. Nguyen.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the GNU Public License v3.0
+ * which accompanies this distribution, and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ *
+ * Contributors:
+ *     Truong-Huy D. Nguyen - initial API and implementation
+ */
+
+
+
+#include "QuantizedQTable.h"
+#include <cmath>
+
+using namespace std;
+
+/**
+  Largest code magnitude; -32768 is left unused so the codes are symmetric around 0.
+*/
+const int MaxCode = 32767;
+
+void QuantizedQTable::quantize(const vector<vector<QValue> >& qFn, long numActs)
+{
+  resize(qFn.size(), numActs);
+  for (long s = 0; s < (long) qFn.size(); s++){
+    const vector<QValue>& row = qFn[s];
+    if (row.empty())
+      continue;
+
+    double low = row[0], high = row[0];
+    for (long a = 1; a < numActs; a++){
+      if (row[a] < low)
+        low = row[a];
+      if (row[a] > high)
+        high = row[a];
+    }
+
+    // Codes are taken against the offset and scale as stored, so the float rounding of
+    // both is part of the quantization error too
+    offsets[s] = (float) ((low + high) / 2);
+    scales[s] = (float) ((high - low) / (2 * MaxCode));
+    if (scales[s] == 0)
+      continue;
+    int16_t* code = &codes[s * numActs];
+    for (long a = 0; a < numActs; a++){
+      double c = floor((row[a] - offsets[s]) / scales[s] + 0.5);
+      code[a] = (int16_t) ((c > MaxCode)? MaxCode : (c < -MaxCode)? -MaxCode : c);
+    }
+  }
+};
+
+void QuantizedQTable::resize(long numStates, long numActs)
+{
+  this->numActs = numActs;
+  vector<float>(numStates, 0).swap(offsets);
+  vector<float>(numStates, 0).swap(scales);
+  vector<int16_t>(numStates * numActs, 0).swap(codes);
+};
+
+void QuantizedQTable::scatter(const vector<long>& index, long numStates)
+{
+  QuantizedQTable placed;
+  placed.resize(numStates, numActs);
+  for (long s = 0; s < (long) index.size() && s < size(); s++){
+    if (index[s] < 0)
+      continue;
+    placed.offsets[index[s]] = offsets[s];
+    placed.scales[index[s]] = scales[s];
+    for (long a = 0; a < numActs; a++)
+      placed.codes[index[s] * numActs + a] = codes[s * numActs + a];
+  }
+  offsets.swap(placed.offsets);
+  scales.swap(placed.scales);
+  codes.swap(placed.codes);
+};
+
+void QuantizedQTable::getRow(long state, vector<QValue>& row) const
+{
+  row.resize(numActs);
+  for (long a = 0; a < numActs; a++)
+    row[a] = get(state, a);
+};
+
+long QuantizedQTable::memoryUsage() const
+{
+  return offsets.capacity() * sizeof(float) + scales.capacity() * sizeof(float)
+      + codes.capacity() * sizeof(int16_t);
+};
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2012 Truong-Huy D. Nguyen.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the GNU Public License v3.0
+ * which accompanies this distribution, and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ *
+ * Contributors:
+ *     Truong-Huy D. Nguyen - initial API and implementation
+ */
+
+
+
+#ifndef __QUANTIZEDQTABLE_H
+#define __QUANTIZEDQTABLE_H
+
+#include <vector>
+#include <stdint.h>
+#include "Precision.h"
+
+/**
+  @class QuantizedQTable
+  @brief Q function stored as one int16 code per action and a float offset and scale per
+  state.
+  @details Q(s, a) = offset[s] + scale[s] * code[s][a]. Each row is quantized over its own
+  range, so the codes are at most scale / 2 off and keep the order of the actions within
+  a state, which is all greedy action selection compares. About a quarter of the size of
+  the rows of QValue.
+*/
+class QuantizedQTable
+{
+public:
+  QuantizedQTable() : numActs(0) {};
+
+  /**
+    Replaces the contents with \a qFn quantized, \a numActs values per state.
+  */
+  void quantize(const std::vector<std::vector<QValue> >& qFn, long numActs);
+
+  /**
+    Sizes the table for \a numStates states of \a numActs actions, all 0, to be filled
+    through the arrays.
+  */
+  void resize(long numStates, long numActs);
+
+  /**
+    Moves the row of every state \a s with \a index[s] >= 0 to \a index[s], in a table of
+    \a numStates states. Rows no state moves to are 0.
+  */
+  void scatter(const std::vector<long>& index, long numStates);
+
+  long size() const { return offsets.size(); };
+  long getNumActs() const { return numActs; };
+
+  QValue get(long state, long act) const { return offsets[state] + scales[state] * codes[state * numActs + act]; };
+
+  /**
+    Dequantizes the row of \a state into \a row.
+  */
+  void getRow(long state, std::vector<QValue>& row) const;
+
+  /**
+    Raw arrays, in state order: size() offsets and scales, size() * getNumActs() codes.
+  */
+  float* offsetData() { return offsets.empty()? 0 : &offsets[0]; };
+  float* scaleData() { return scales.empty()? 0 : &scales[0]; };
+  int16_t* codeData() { return codes.empty()? 0 : &codes[0]; };
+  const float* offsetData() const { return offsets.empty()? 0 : &offsets[0]; };
+  const float* scaleData() const { return scales.empty()? 0 : &scales[0]; };
+  const int16_t* codeData() const { return codes.empty()? 0 : &codes[0]; };
+
+  /**
+    Approximate number of bytes held by the table.
+  */
+  long memoryUsage() const;
+
+private:
+  long numActs;
+  std::vector<float> offsets;
+  std::vector<float> scales;
+  std::vector<int16_t> codes;
+};
+
+#endif // __QUANTIZEDQTABLE_H
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2012 Truong-Huy D. Nguyen.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the GNU Public License v3.0
+ * which accompanies this distribution, and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * 
+ * Contributors:
+ *     Truong-Huy D. Nguyen - initial API and implementation
+ */
+
+
+
+#include "ScratchArena.h"
+
+using namespace std;
+
+__thread ScratchArena* ScratchArena::active = 0;
+
+ScratchArena::~ScratchArena()
+{
+  for (unsigned b = 0; b < blocks.size(); b++)
+    free(blocks[b]);
+};
+
+void* ScratchArena::allocate(size_t bytes)
+{
+  // keep every allocation 16-byte aligned
+  bytes = (bytes + 15) & ~(size_t) 15;
+  while (currBlock < blocks.size() && offset + bytes > blockSizes[currBlock]){
+    currBlock++;
+    offset = 0;
+  }
+  if (currBlock == blocks.size()){
+    size_t size = (bytes > blockSize)? bytes : blockSize;
+    char* block = (char*) malloc(size);
+    if (!block)
+      return 0;
+    blocks.push_back(block);
+    blockSizes.push_back(size);
+  }
+  void* p = blocks[currBlock] + offset;
+  offset += bytes;
+  return p;
+};
+
+bool ScratchArena::owns(const void* p) const
+{
+  const char* c = (const char*) p;
+  for (unsigned b = 0; b < blocks.size(); b++){
+    if (c >= blocks[b] && c < blocks[b] + blockSizes[b])
+      return true;
+  }
+  return false;
+};
+
+size_t ScratchArena::capacity() const
+{
+  size_t total = 0;
+  for (unsigned b = 0; b < blockSizes.size(); b++)
+    total += blockSizes[b];
+  return total;
+};
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2012 Truong-Huy D. Nguyen.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the GNU Public License v3.0
+ * which accompanies this distribution, and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * 
+ * Contributors:
+ *     Truong-Huy D. Nguyen - initial API and implementation
+ */
+
+
+
+#ifndef __SCRATCHARENA_H
+#define __SCRATCHARENA_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+/**
+  @class ScratchArena
+  @brief Per-thread bump allocator for the short-lived vectors of the planning dynamics.
+  @details While an arena is active on a thread (see Scope), every ArenaAllocator on that
+  thread carves its memory out of the arena's blocks and frees nothing; \a reset rewinds
+  the arena so the same blocks serve the next evaluation. Without an active arena the
+  allocator falls back to malloc/free. Memory from the arena must not outlive the next
+  reset, nor be released once the arena is no longer active.
+*/
+class ScratchArena
+{
+public:
+  /**
+     Makes \a arena the active arena of the calling thread for the lifetime of the Scope.
+  */
+  class Scope
+  {
+  public:
+    Scope(ScratchArena& arena) : previous(active) { active = &arena; };
+    ~Scope() { active = previous; };
+  private:
+    ScratchArena* previous;
+  };
+
+  ScratchArena(size_t blockSize = 1 << 20) : blockSize(blockSize), currBlock(0), offset(0) {};
+  ~ScratchArena();
+
+  /**
+     @return the calling thread's active arena, 0 if none
+  */
+  static inline ScratchArena* current() { return active; };
+
+  void* allocate(size_t bytes);
+
+  /**
+     @return true if \a p lies in one of this arena's blocks
+  */
+  bool owns(const void* p) const;
+
+  /**
+     Releases everything allocated since the last reset, keeping the blocks.
+  */
+  inline void reset() { currBlock = 0; offset = 0; };
+
+  /**
+     Bytes held in blocks.
+  */
+  size_t capacity() const;
+
+private:
+  static __thread ScratchArena* active;
+
+  size_t blockSize;
+  std::vector<char*> blocks;
+  std::vector<size_t> blockSizes;
+  size_t currBlock;
+  size_t offset;
+
+  // not copyable
+  ScratchArena(const ScratchArena&);
+  ScratchArena& operator=(const ScratchArena&);
+};
+
+/**
+  STL allocator drawing from the calling thread's active ScratchArena.
+*/
+template<class T>
+class ArenaAllocator
+{
+public:
+  typedef T value_type;
+  typedef T* pointer;
+  typedef const T* const_pointer;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  template<class U> struct rebind { typedef ArenaAllocator<U> other; };
+
+  ArenaAllocator() {};
+  ArenaAllocator(const ArenaAllocator&) {};
+  template<class U> ArenaAllocator(const ArenaAllocator<U>&) {};
+
+  pointer address(reference x) const { return &x; };
+  const_pointer address(const_reference x) const { return &x; };
+
+  pointer allocate(size_type n, const void* = 0)
+  {
+    ScratchArena* arena = ScratchArena::current();
+    void* p = arena? arena->allocate(n * sizeof(T)) : malloc(n * sizeof(T));
+    if (!p)
+      throw std::bad_alloc();
+    return (pointer) p;
+  };
+
+  void deallocate(pointer p, size_type)
+  {
+    ScratchArena* arena = ScratchArena::current();
+    if (!arena || !arena->owns(p))
+      free(p);
+  };
+
+  size_type max_size() const { return size_t(-1) / sizeof(T); };
+
+  void construct(pointer p, const T& value) { new ((void*) p) T(value); };
+  void destroy(pointer p) { p->~T(); };
+
+  template<class U> bool operator==(const ArenaAllocator<U>&) const { return true; };
+  template<class U> bool operator!=(const ArenaAllocator<U>&) const { return false; };
+};
+
+#endif // __SCRATCHARENA_H
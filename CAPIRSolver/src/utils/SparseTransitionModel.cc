@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2012 Truong-Huy D. Nguyen.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the GNU Public License v3.0
+ * which accompanies this distribution, and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * 
+ * Contributors:
+ *     Truong-Huy D. Nguyen - initial API and implementation
+ */
+
+
+
+#include "SparseTransitionModel.h"
+#include <iostream>
+#include <cstdlib>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const char* fileSuffix[4] = {".rows", ".next", ".prob", ".rew"};
+
+SparseTransitionModel::SparseTransitionModel(long numStates, long numActions, const std::string& filePrefix): numStates(numStates), numActions(numActions), numEntries(0), filePrefix(filePrefix)
+{
+  for (int f = 0; f < 4; f++){
+    files[f] = 0;
+    mapped[f] = 0;
+    mappedSize[f] = 0;
+  }
+  if (isOutOfCore()){
+    rowStart = 0;
+    nextStates = 0;
+    probs = 0;
+    rewards = 0;
+    openFiles();
+    long zero = 0;
+    writeFile(0, &zero, sizeof(long));
+    return;
+  }
+  rowStartVec.reserve(numStates * numActions + 1);
+  rowStartVec.push_back(0);
+  rewardVec.reserve(numStates * numActions);
+  updatePointers();
+};
+
+SparseTransitionModel::~SparseTransitionModel()
+{
+  clear();
+};
+
+void SparseTransitionModel::openFiles()
+{
+  for (int f = 0; f < 4; f++){
+    string filename = filePrefix + fileSuffix[f];
+    files[f] = fopen(filename.c_str(), "w+b");
+    if (!files[f]){
+      cerr << "Fail to open " << filename << "\n";
+      exit(EXIT_FAILURE);
+    }
+  }
+};
+
+void SparseTransitionModel::writeFile(int f, const void* data, size_t size)
+{
+  if (fwrite(data, size, 1, files[f]) != 1){
+    cerr << "Fail to write " << filePrefix << fileSuffix[f] << "\n";
+    exit(EXIT_FAILURE);
+  }
+};
+
+void SparseTransitionModel::reserveEntries(long count)
+{
+  for (int f = 1; f < 3; f++){
+    size_t size = count * ((f == 1)? sizeof(int) : sizeof(TransProb));
+    if (size <= mappedSize[f])
+      continue;
+    // the pages are only resident once written, so doubling the mapping costs no memory
+    size_t newSize = (2 * mappedSize[f] > size)? 2 * mappedSize[f] : size;
+    void* p = mapped[f]? mremap(mapped[f], mappedSize[f], newSize, MREMAP_MAYMOVE)
+      : mmap(0, newSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED){
+      cerr << "Fail to allocate " << newSize << " bytes of transition entries\n";
+      exit(EXIT_FAILURE);
+    }
+    mapped[f] = p;
+    mappedSize[f] = newSize;
+  }
+};
+
+void SparseTransitionModel::addRow(const std::vector<std::pair<long,double> >& row, double reward)
+{
+  QValue rowReward = (QValue) reward;
+  if (isOutOfCore()){
+    for (unsigned k = 0; k < row.size(); k++){
+      int next = (int) row[k].first;
+      TransProb prob = (TransProb) row[k].second;
+      writeFile(1, &next, sizeof(int));
+      writeFile(2, &prob, sizeof(TransProb));
+    }
+    numEntries += row.size();
+    writeFile(0, &numEntries, sizeof(long));
+    writeFile(3, &rowReward, sizeof(QValue));
+    return;
+  }
+
+  reserveEntries(numEntries + row.size());
+  int* next = (int*) mapped[1] + numEntries;
+  TransProb* prob = (TransProb*) mapped[2] + numEntries;
+  for (unsigned k = 0; k < row.size(); k++){
+    next[k] = (int) row[k].first;
+    prob[k] = (TransProb) row[k].second;
+  }
+  numEntries += row.size();
+  rowStartVec.push_back(numEntries);
+  rewardVec.push_back(rowReward);
+  updatePointers();
+};
+
+void SparseTransitionModel::updatePointers()
+{
+  rowStart = rowStartVec.empty()? 0 : &rowStartVec[0];
+  nextStates = (const int*) mapped[1];
+  probs = (const TransProb*) mapped[2];
+  rewards = rewardVec.empty()? 0 : &rewardVec[0];
+};
+
+void SparseTransitionModel::mapFiles()
+{
+  // a short file (e.g. a full disk) would have the sweeps read past its mapping
+  size_t expectedSize[4] = {(numStates * numActions + 1) * sizeof(long),
+                            numEntries * sizeof(int), numEntries * sizeof(TransProb),
+                            numStates * numActions * sizeof(QValue)};
+  for (int f = 0; f < 4; f++){
+    int fd = fileno(files[f]);
+    struct stat st;
+    if (fflush(files[f]) != 0 || fstat(fd, &st) != 0){
+      cerr << "Fail to write " << filePrefix << fileSuffix[f] << "\n";
+      exit(EXIT_FAILURE);
+    }
+    if ((size_t) st.st_size != expectedSize[f]){
+      cerr << filePrefix << fileSuffix[f] << " has " << st.st_size << " bytes, expected "
+           << expectedSize[f] << "\n";
+      exit(EXIT_FAILURE);
+    }
+    mappedSize[f] = st.st_size;
+    if (mappedSize[f] == 0)
+      continue;
+    mapped[f] = mmap(0, mappedSize[f], PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped[f] == MAP_FAILED){
+      cerr << "Fail to map " << filePrefix << fileSuffix[f] << "\n";
+      exit(EXIT_FAILURE);
+    }
+    // sweeps read every array front to back
+    madvise(mapped[f], mappedSize[f], MADV_SEQUENTIAL);
+  }
+  rowStart = (const long*) mapped[0];
+  nextStates = (const int*) mapped[1];
+  probs = (const TransProb*) mapped[2];
+  rewards = (const QValue*) mapped[3];
+};
+
+void SparseTransitionModel::unmapFiles()
+{
+  for (int f = 0; f < 4; f++){
+    if (mapped[f])
+      munmap(mapped[f], mappedSize[f]);
+    mapped[f] = 0;
+    mappedSize[f] = 0;
+    if (files[f]){
+      fclose(files[f]);
+      files[f] = 0;
+      unlink((filePrefix + fileSuffix[f]).c_str());
+    }
+  }
+};
+
+void SparseTransitionModel::shrinkToFit()
+{
+  if (isOutOfCore()){
+    if (!mapped[0])
+      mapFiles();
+    return;
+  }
+  // rowStartVec and rewardVec were reserved at their final size; the entry mappings are
+  // cut down in place, without the copy that would hold two of the largest arrays at once
+  for (int f = 1; f < 3; f++){
+    size_t size = numEntries * ((f == 1)? sizeof(int) : sizeof(TransProb));
+    if (size == 0 || size >= mappedSize[f])
+      continue;
+    void* p = mremap(mapped[f], mappedSize[f], size, 0);
+    if (p == MAP_FAILED)
+      continue;
+    mapped[f] = p;
+    mappedSize[f] = size;
+  }
+  updatePointers();
+};
+
+void SparseTransitionModel::clear()
+{
+  unmapFiles();
+  vector<long>().swap(rowStartVec);
+  vector<QValue>().swap(rewardVec);
+  updatePointers();
+};
+
+long SparseTransitionModel::memoryUsage() const
+{
+  if (isOutOfCore())
+    return 0;
+  return rowStartVec.capacity() * sizeof(long) + rewardVec.capacity() * sizeof(QValue)
+    + numEntries * (sizeof(int) + sizeof(TransProb));
+};
@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2012 Truong-Huy D. Nguyen.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the GNU Public License v3.0
+ * which accompanies this distribution, and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ * 
+ * Contributors:
+ *     Truong-Huy D. Nguyen - initial API and implementation
+ */
+
+
+
+#ifndef __SPARSETRANSITIONMODEL_H
+#define __SPARSETRANSITIONMODEL_H
+
+#include <vector>
+#include <utility>
+#include <string>
+#include <cstdio>
+#include "Precision.h"
+
+/**
+   @class SparseTransitionModel
+   @brief Transition function of an MDP stored in compressed sparse row form.
+   @details Row r = state * numActions + action holds the successors of taking
+   action in state. Its entries are nextStates[rowStart[r] .. rowStart[r+1]) with
+   the matching probabilities in probs, and its expected reward is rewards[r]. Rows
+   must be added in row order, and shrinkToFit must be called once the last row is in.
+
+   Out-of-core mode (a file prefix given to the constructor) streams the four arrays to files
+   instead of keeping them in memory; shrinkToFit then maps the files read-only,
+   so sweeps page through them sequentially.
+*/
+class SparseTransitionModel
+{
+ public:
+    /**
+       With a non-empty \a filePrefix the model is out-of-core, backed by
+       \a filePrefix.rows, .next, .prob and .rew. The files are removed by \a clear or
+       the destructor.
+    */
+    SparseTransitionModel(long numStates, long numActions, const std::string& filePrefix = "");
+
+    ~SparseTransitionModel();
+
+    /**
+       Appends the next row, i.e. the successors of the next (state, action) pair and
+       the expected \a reward of taking it.
+    */
+    void addRow(const std::vector<std::pair<long,double> >& row, double reward);
+
+    /**
+       Trims the arrays to their size, in place, once all rows have been added. In
+       out-of-core mode, flushes the files and maps them.
+    */
+    void shrinkToFit();
+
+    /**
+       Releases the storage.
+    */
+    void clear();
+
+    /**
+       Approximate number of bytes held in memory by the model (mapped files excluded).
+    */
+    long memoryUsage() const;
+
+    inline bool isOutOfCore() const { return !filePrefix.empty(); };
+    inline long getNumStates() const { return numStates; };
+    inline long getNumActions() const { return numActions; };
+    inline long getNumEntries() const { return numEntries; };
+
+    inline long rowBegin(long state, long action) const { return rowStart[state * numActions + action]; };
+    inline long rowEnd(long state, long action) const { return rowStart[state * numActions + action + 1]; };
+
+    inline QValue reward(long state, long action) const { return rewards[state * numActions + action]; };
+
+    /**
+       Rewards of the numActions actions of \a state.
+    */
+    inline const QValue* stateRewards(long state) const { return rewards + state * numActions; };
+
+    /**
+       Row offsets, numStates * numActions + 1 of them.
+    */
+    const long* rowStart;
+    /**
+       Packed next-state indices.
+    */
+    const int* nextStates;
+    /**
+       Packed probabilities, parallel to nextStates.
+    */
+    const TransProb* probs;
+    /**
+       Expected reward of every row, numStates * numActions of them.
+    */
+    const QValue* rewards;
+
+ private:
+    long numStates;
+    long numActions;
+    long numEntries;
+
+    // in-memory storage; the entries live in anonymous mappings, mapped[1] and mapped[2]
+    std::vector<long> rowStartVec;
+    std::vector<QValue> rewardVec;
+
+    // out-of-core storage
+    std::string filePrefix;
+    FILE* files[4];
+    void* mapped[4];
+    size_t mappedSize[4];
+
+    void updatePointers();
+    // grows the in-memory entry mappings to hold \a count entries, without copying them
+    void reserveEntries(long count);
+    void openFiles();
+    // appends \a size bytes at \a data to file \a f, exiting if they cannot all be written
+    void writeFile(int f, const void* data, size_t size);
+    void mapFiles();
+    void unmapFiles();
+
+    // not copyable
+    SparseTransitionModel(const SparseTransitionModel&);
+    SparseTransitionModel& operator=(const SparseTransitionModel&);
+};
+
+#endif // __SPARSETRANSITIONMODEL_H
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2012 Truong-Huy D. Nguyen.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the GNU Public License v3.0
+ * which accompanies this distribution, and is available at
+ * http://www.gnu.org/licenses/gpl.html
+ *
+ * Contributors:
+ *     Truong-Huy D. Nguyen - initial API and implementation
+ */
+
+
+
+#ifndef __SUCCESSORACCUMULATOR_H
+#define __SUCCESSORACCUMULATOR_H
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+/**
+  @class SuccessorAccumulator
+  @brief Merges (next state, probability) pairs so that every next state appears once.
+  @details Entries are kept sorted by state index in a fixed inline buffer of
+  \a InlineCapacity slots, so adding a successor is a binary search plus a short shift
+  and a typical row never touches the heap. A row with more distinct successors than
+  that moves to a heap vector, still sorted. The accumulated row is written out in
+  ascending state order, which also keeps the value lookups of a backup moving forward
+  through memory.
+*/
+class SuccessorAccumulator
+{
+public:
+  static const unsigned InlineCapacity = 32;
+
+  SuccessorAccumulator() : count(0) {};
+
+  /**
+    Forgets all successors.
+  */
+  inline void clear()
+  {
+    count = 0;
+    spill.resize(0);
+  };
+
+  /**
+    Number of distinct successors added since the last clear().
+  */
+  inline size_t size() const
+  {
+    return spill.empty() ? count : spill.size();
+  };
+
+  /**
+    Adds probability \a prob to next state \a state, inserting it if it is new.
+  */
+  void add(long state, double prob)
+  {
+    if (!spill.empty()) {
+      std::vector<std::pair<long, double> >::iterator it = std::lower_bound(
+          spill.begin(), spill.end(), std::pair<long, double>(state, 0), lessState);
+      if (it != spill.end() && it->first == state)
+        it->second += prob;
+      else
+        spill.insert(it, std::pair<long, double>(state, prob));
+      return;
+    }
+
+    unsigned pos = std::lower_bound(states, states + count, state) - states;
+    if (pos < count && states[pos] == state) {
+      probs[pos] += prob;
+      return;
+    }
+
+    if (count == InlineCapacity) {
+      // inline buffer is full: continue in the heap vector
+      spill.reserve(2 * InlineCapacity);
+      for (unsigned i = 0; i < count; i++)
+        spill.push_back(std::pair<long, double>(states[i], probs[i]));
+      spill.insert(spill.begin() + pos, std::pair<long, double>(state, prob));
+      return;
+    }
+
+    for (unsigned i = count; i > pos; i--) {
+      states[i] = states[i - 1];
+      probs[i] = probs[i - 1];
+    }
+    states[pos] = state;
+    probs[pos] = prob;
+    count++;
+  };
+
+  /**
+    Writes the successors to \a output in ascending state order, replacing its contents.
+  */
+  void copyTo(std::vector<std::pair<long, double> >& output) const
+  {
+    if (!spill.empty()) {
+      output.assign(spill.begin(), spill.end());
+      return;
+    }
+    output.resize(count);
+    for (unsigned i = 0; i < count; i++) {
+      output[i].first = states[i];
+      output[i].second = probs[i];
+    }
+  };
+
+private:
+  static bool lessState(const std::pair<long, double>& a,
+      const std::pair<long, double>& b)
+  {
+    return a.first < b.first;
+  };
+
+  long states[InlineCapacity];
+  double probs[InlineCapacity];
+  unsigned count;
+
+  // holds all successors once there are more than InlineCapacity of them
+  std::vector<std::pair<long, double> > spill;
+};
+
+#endif // __SUCCESSORACCUMULATOR_H
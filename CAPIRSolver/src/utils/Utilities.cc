@@ -179,7 +179,7 @@ void Utilities::AbstractStateToOutStream(const AbstractState& state, std::ostrea
 
 };
 
-void Utilities::LongVectorToOutStream(const std::vector<long>& longVector, std::ostream& outStr)
+void Utilities::LongVectorToOutStream(const PropertyVector& longVector, std::ostream& outStr)
 {
 	for (unsigned k = 0; k< longVector.size(); k++)
 		outStr << longVector[k] << " ";
@@ -208,7 +208,7 @@ void Utilities::printAbsState(const AbstractState& state) {
 	std::cout << std::endl;
 }
 ;
-void Utilities::cloneAbsState(AbstractState& inState, AbstractState& outState) {
+void Utilities::cloneAbsState(const AbstractState& inState, AbstractState& outState) {
 	outState.playerProperties[humanIndex].resize(0);
 	outState.playerProperties[aiIndex].resize(0);
 	outState.monsterProperties.resize(0);
@@ -233,12 +233,13 @@ void Utilities::cloneAbsState(AbstractState& inState, AbstractState& outState) {
 ;
 
 void Utilities::addAbsStateToVector(AbstractState& absState, double prob,
-    std::vector<std::pair<AbstractState, double> >& output) {
+    abstractStateBelief& output) {
 	long curr = -1;
 	for (unsigned l = 0; l < output.size(); l++) {
-		if (isEqualAbsState(output[l].first, absState))
+		if (isEqualAbsState(output[l].first, absState)) {
 			curr = l;
-		break;
+			break;
+		}
 	}
 
 	// if absState is not in the output vector yet, add it
@@ -255,9 +256,10 @@ void Utilities::addLongAbsStateToVector(long absState, double prob,
     sparseStateBelief& output) {
 	long curr = -1;
 	for (unsigned l = 0; l < output.size(); l++) {
-		if (output[l].first == absState)
+		if (output[l].first == absState) {
 			curr = l;
-		break;
+			break;
+		}
 	}
 
 	// if absState is not in the output vector yet, add it
@@ -281,8 +283,8 @@ void Utilities::copyAbstractStateArray(std::vector<AbstractState>& input,
 ;
 
 void Utilities::copyAbstractProbArray(
-    std::vector<std::pair<AbstractState, double> >& input,
-    std::vector<std::pair<AbstractState, double> >& output) {
+    abstractStateBelief& input,
+    abstractStateBelief& output) {
 	output.resize(0);
 
 	for (unsigned k = 0; k < input.size(); k++) {
@@ -292,8 +294,8 @@ void Utilities::copyAbstractProbArray(
 ;
 
 void Utilities::copyAbstractProbArray(
-    std::vector<std::pair<AbstractState, double> >& input, double prob,
-    std::vector<std::pair<AbstractState, double> >& output) {
+    abstractStateBelief& input, double prob,
+    abstractStateBelief& output) {
 	output.resize(0);
 
 	for (unsigned k = 0; k < input.size(); k++) {
@@ -343,13 +345,14 @@ bool Utilities::isEqualAbsState(const AbstractState& p1,
  */
 
 void Utilities::addAbsStateRewardToVector(AbstractState& absState, double prob,
-    std::vector<std::pair<AbstractState, double> >& output, double reward,
+    abstractStateBelief& output, double reward,
     std::vector<double>& rewards) {
 	long curr = -1;
 	for (unsigned l = 0; l < output.size(); l++) {
-		if (isEqualAbsState(output[l].first, absState))
+		if (isEqualAbsState(output[l].first, absState)) {
 			curr = l;
-		break;
+			break;
+		}
 	}
 
 	// if absState is not in the output vector yet, add it
@@ -366,7 +369,7 @@ void Utilities::addAbsStateRewardToVector(AbstractState& absState, double prob,
 ;
 
 void Utilities::absDoNothing(const AbstractState& currAbsState, double prob,
-    std::vector<std::pair<AbstractState, double> >& output) {
+    abstractStateBelief& output) {
 	output.resize(0);
 	output.push_back(std::pair<AbstractState, double>(currAbsState, prob));
 }
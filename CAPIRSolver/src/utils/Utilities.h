@@ -22,6 +22,8 @@
 #include <string>
 #include <climits>
 #include <typeinfo>
+#include "InlineVector.h"
+#include "ScratchArena.h"
 
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -67,15 +69,26 @@ const int BUFF_SIZE = 2000;
 /************** Structs/typedefs ***************/
 
 
+/**
+  Live instance counter. Updated atomically, since states are created and destroyed
+  by several model construction threads at once.
+*/
 template<class T>
 class Stats {
   static long instance_count;
 public:
   Stats() {
-    instance_count++;
+    __sync_fetch_and_add(&instance_count, 1);
+  }
+  Stats(const Stats&) {
+    __sync_fetch_and_add(&instance_count, 1);
+  }
+  // assignment keeps the number of instances
+  Stats& operator=(const Stats&) {
+    return *this;
   }
   ~Stats() {
-    instance_count--;
+    __sync_fetch_and_sub(&instance_count, 1);
   }
   static void print() {
     std::cout << instance_count << " instances of " << typeid(T).name() <<
@@ -86,13 +99,24 @@ public:
 template<class T>
 long Stats<T>::instance_count = 0;
 
+/**
+  Element type of state properties. Coordinates, region ids, flags and counters all fit
+  in 32 bits, and so does TermState.
+*/
+typedef int PropertyValue;
+/**
+  Properties of one entity: (region, x, y) or (x, y, seesHuman, seesAssistant) plus a
+  couple of counters fit inline, longer lists spill to the heap.
+*/
+typedef InlineVector<PropertyValue, 6> PropertyVector;
+
 struct State : Stats<State>
 {
   // humanProperties: (coordX, coordY, <additional properties>)
-  std::vector<long> playerProperties[2];
+  PropertyVector playerProperties[2];
   
   // (coordX, coordY, <additional properties>)
-  std::vector< std::vector<long> > mazeProperties;
+  std::vector<PropertyVector> mazeProperties;
 
   inline bool operator == (const State &o) const {
 	// playerProperties
@@ -128,15 +152,15 @@ struct AugmentedState : State
 struct AbstractState : Stats<AbstractState>
 {
   // humanProperties: (regionId, coordX, coordY, <additional properties>)
-  std::vector<long> playerProperties[2];
+  PropertyVector playerProperties[2];
   
   // if monsterProperties is not empty: 
   // (coordX, coordY, seesHuman, seesAssistant, <additional properties>)
-  std::vector<long> monsterProperties;
+  PropertyVector monsterProperties;
   
   // if specialLocationProperties is not empty: 
   // (<additional properties>)
-  std::vector<long> specialLocationProperties;
+  PropertyVector specialLocationProperties;
 
 };
  
@@ -145,6 +169,13 @@ struct AbstractState : Stats<AbstractState>
 */ 
 typedef std::vector<std::pair<long, double> > sparseStateBelief; 
 
+/**
+  Distribution over AbstractStates used while planning. Its storage comes from the
+  thread's ScratchArena while one is active (model construction), so the many
+  short-lived copies made by the dynamics cost no malloc/free.
+*/
+typedef std::vector<std::pair<AbstractState, double>, ArenaAllocator<std::pair<AbstractState, double> > > abstractStateBelief;
+
 /***************** Class ***********************/
 
 class Utilities
@@ -162,6 +193,13 @@ public:
   */
   enum goalType{orType, andType};
 
+  /**
+    Format of the .Ftn Q function files written by MazeWorld::writeSolution
+    - text: zlib-compressed fixed-point text, the original format.
+    - binary: a versioned header and the raw Q array, loaded by mapping the file.
+  */
+  enum solutionFormatType{textSolution, binarySolution};
+
 
   /****************** Comparator ***********************/
   class StateComparator {
@@ -280,7 +318,7 @@ public:
   
   static void AugStateToOutStream(const AugmentedState& state, std::ostream& outStr);
   static void AbstractStateToOutStream(const AbstractState& state, std::ostream& outStr);
-  static void LongVectorToOutStream(const std::vector<long>& state, std::ostream& outStr);
+  static void LongVectorToOutStream(const PropertyVector& state, std::ostream& outStr);
 
   /************ Abstract State Utility routines ************************/
   /**
@@ -290,11 +328,11 @@ public:
   /**
     Copies from AbstractState \a inState to \a outState.
   */
-  static void cloneAbsState(AbstractState& inState, AbstractState& outState);
+  static void cloneAbsState(const AbstractState& inState, AbstractState& outState);
   /**
     Adds AbstractState \a absState with probability \a prob to vector \a output. If \a absState already exists in \a output, its probability wil be merged.
   */
-  static void addAbsStateToVector(AbstractState& absState, double prob, std::vector< std::pair<AbstractState, double> >& output);
+  static void addAbsStateToVector(AbstractState& absState, double prob, abstractStateBelief& output);
   /**
     Adds long form of AbstractState \a absState with probability \a prob to the state belief \a output. If \a absState already exists in \a output, its probability wil be merged.
   */
@@ -306,12 +344,12 @@ public:
   /**
     Copies vectors of AbstractState with probability from \a input to \a output.
   */
-  static void copyAbstractProbArray(std::vector< std::pair<AbstractState, double> >& input, std::vector< std::pair<AbstractState, double> >& output);  
+  static void copyAbstractProbArray(abstractStateBelief& input, abstractStateBelief& output);  
   
   /**
     Similar to copyAbstractProbArray but multiplies the probabilities in input by \a prob to produce \a output.
   */
-  static void copyAbstractProbArray(std::vector< std::pair<AbstractState, double> >& input, double prob, std::vector< std::pair<AbstractState, double> >& output);  
+  static void copyAbstractProbArray(abstractStateBelief& input, double prob, abstractStateBelief& output);  
   /**
     Compares AbstractState \a p1 and \a p2.
   */
@@ -320,12 +358,12 @@ public:
   /**
     Adds AbstractState \a absState with probability \a prob to vector \a output and respective \a reward to vector \a rewards. If \a absState already exists in \a output, its probability and reward wil be merged in corresponding vectors.
   */
-  static void addAbsStateRewardToVector(AbstractState& absState, double prob, std::vector< std::pair<AbstractState, double> >& output, double reward, std::vector <double>& rewards);
+  static void addAbsStateRewardToVector(AbstractState& absState, double prob, abstractStateBelief& output, double reward, std::vector <double>& rewards);
 
   /**
     When planning, adds \a currAbsState with probability \a prob to empty vector \a output.
   */
-  static void absDoNothing(const AbstractState& currAbsState, double prob, std::vector< std::pair<AbstractState, double> >& output);
+  static void absDoNothing(const AbstractState& currAbsState, double prob, abstractStateBelief& output);
 
 };
 #endif
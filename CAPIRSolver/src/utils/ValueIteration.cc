@@ -12,16 +12,623 @@
 
 
 #include "ValueIteration.h"
+#include <algorithm>
 #include <cfloat>
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
 #include <fstream>
 #include <time.h>
+#include <pthread.h>
+#include <sstream>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+#include <signal.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
 
 using namespace std;
 
-void ValueIteration::doValueIteration(std::vector<std::vector<double> >& rewardMatrix, std::vector<std::vector<std::vector<std::pair<long,double> > > >& transMatrix, double targetPrecision, long displayInterval)
+/**
+   Arguments handed to each sweep thread.
+*/
+struct SweepTask
+{
+  ValueIteration* solver;
+  SparseTransitionModel* transMatrix;
+  const vector<QValue>* prevValues;
+  vector<QValue>* currValues;
+  long begin, end;
+  double maxChange;
+  double deltaRange[2];
+};
+
+void* ValueIteration::sweepWorker(void* arg)
+{
+  SweepTask* task = (SweepTask*) arg;
+  task->maxChange = task->solver->sweepRange(*(task->transMatrix),
+      &(*task->prevValues)[0], &(*task->currValues)[0], task->begin, task->end, task->deltaRange);
+  return NULL;
+};
+
+double ValueIteration::sweepRange(SparseTransitionModel& transMatrix, const QValue* prevValues, QValue* currValues, long begin, long end, double* deltaRange)
+{
+  double maxChange = 0, minDelta = 0, maxDelta = 0;
+  // For each state, look for the best value that goes with best action in that state
+  for (long idx = begin; idx < end; idx++){
+    long i = sweepOrder.empty()? idx : sweepOrder[idx];
+    long bestAction;
+    double bestValue;
+    if (eliminate && sweep == jacobiSweep)
+      bestValue = eliminationBackup(transMatrix.stateRewards(i), transMatrix, i, prevValues, bestAction);
+    else
+      bestValue = backupKernel(transMatrix.stateRewards(i), transMatrix, i, prevValues,
+          discount, numActions, bestAction, qOutput? &(*qOutput)[i][0] : 0);
+
+    QValue newValue = (QValue) bestValue;
+    double delta = newValue - prevValues[i];
+    if (fabs(delta) > maxChange)
+      maxChange = fabs(delta);
+    if (delta < minDelta || idx == begin)
+      minDelta = delta;
+    if (delta > maxDelta || idx == begin)
+      maxDelta = delta;
+    // For this iteration currValues store the best value of the state thus far
+    currValues[i] = newValue;
+    actions[i] = bestAction;
+  }
+  if (deltaRange){
+    deltaRange[0] = minDelta;
+    deltaRange[1] = maxDelta;
+  }
+  return maxChange;
+};
+
+double ValueIteration::eliminationBackup(const QValue* reward, SparseTransitionModel& transMatrix, long i, const QValue* values, long& bestAction)
+{
+  unsigned char* acts = &activeActs[i * numActions];
+  long n = numActive[i];
+  const QValue* bound = bounds[boundRead];
+  double qUpper[256];
+  double bestValue = -FLT_MAX, bestUpper = -FLT_MAX, bestLower = -FLT_MAX;
+  bestAction = acts[0];
+
+  for (long a = 0; a < n; a++){
+    long j = acts[a];
+    double currValue = reward[j], currUpper = reward[j], currLower = reward[j];
+    for (long k = transMatrix.rowBegin(i, j); k < transMatrix.rowEnd(i, j); k++){
+      long next = transMatrix.nextStates[k];
+      double prob = discount * transMatrix.probs[k];
+      currValue += prob * values[next];
+      currUpper += prob * bound[2 * next];
+      currLower += prob * bound[2 * next + 1];
+    }
+    qUpper[a] = currUpper;
+    if (currValue > bestValue){
+      bestValue = currValue;
+      bestAction = j;
+    }
+    if (currUpper > bestUpper)
+      bestUpper = currUpper;
+    if (currLower > bestLower)
+      bestLower = currLower;
+  }
+
+  // The optimal action is never dropped, so the best of the kept actions still bounds
+  // V*(i); so do the old bounds and MacQueen's. Keep the tightest.
+  QValue* newBound = bounds[1 - boundRead] + 2 * i;
+  newBound[0] = (QValue) min(min((double) bound[2 * i], values[i] + upperOffset), bestUpper);
+  newBound[1] = (QValue) max(max((double) bound[2 * i + 1], values[i] + lowerOffset), bestLower);
+
+  // keep an action unless its upper bound is below the lower bound of the best action
+  long kept = 0;
+  for (long a = 0; a < n; a++){
+    if (qUpper[a] >= bestLower)
+      acts[kept++] = acts[a];
+  }
+  numActive[i] = (unsigned char) kept;
+  return bestValue;
+};
+
+void ValueIteration::initBounds(SparseTransitionModel& transMatrix)
+{
+  // 1. A state whose every action loops back to it is worth its best reward forever
+  vector<char> absorbing(numStates, 0);
+  vector<double> absorbingValue(numStates, 0);
+  for (long i = 0; i < numStates; i++){
+    bool loops = true;
+    double best = -DBL_MAX;
+    for (long j = 0; j < numActions && loops; j++){
+      long k = transMatrix.rowBegin(i, j);
+      loops = (transMatrix.rowEnd(i, j) == k + 1) && (transMatrix.nextStates[k] == i);
+      best = max(best, transMatrix.reward(i, j) / (1 - discount));
+    }
+    absorbing[i] = loops;
+    absorbingValue[i] = best;
+  }
+
+  // 2. If every rewarded transition ends in absorbing states worth 0, a run collects at
+  // most one reward, so V* lies within the rewards themselves rather than within the
+  // rewards / (1 - discount) valueMin and valueMax allow for
+  bool singleReward = true;
+  double rMin = 0, rMax = 0;
+  for (long i = 0; i < numStates && singleReward; i++){
+    for (long j = 0; j < numActions && singleReward; j++){
+      double r = transMatrix.reward(i, j);
+      if (r == 0)
+        continue;
+      rMin = min(rMin, r);
+      rMax = max(rMax, r);
+      for (long k = transMatrix.rowBegin(i, j); k < transMatrix.rowEnd(i, j); k++){
+        long next = transMatrix.nextStates[k];
+        if (!absorbing[next] || absorbingValue[next] != 0)
+          singleReward = false;
+      }
+    }
+  }
+  double vMin = singleReward? max(valueMin, rMin) : valueMin;
+  double vMax = singleReward? min(valueMax, rMax) : valueMax;
+
+  boundStore.resize(4 * numStates);
+  bounds[0] = &boundStore[0];
+  bounds[1] = &boundStore[2 * numStates];
+  for (long i = 0; i < numStates; i++){
+    bounds[0][2 * i] = (QValue) (absorbing[i]? absorbingValue[i] : vMax);
+    bounds[0][2 * i + 1] = (QValue) (absorbing[i]? absorbingValue[i] : vMin);
+    bounds[1][2 * i] = bounds[0][2 * i];
+    bounds[1][2 * i + 1] = bounds[0][2 * i + 1];
+  }
+  boundRead = 0;
+  // no sweep yet, so no MacQueen bounds
+  lowerOffset = -DBL_MAX;
+  upperOffset = DBL_MAX;
+};
+
+void ValueIteration::nextBounds(const double* deltaRange)
+{
+  boundRead = 1 - boundRead;
+  // V* - V' lies within discount / (1 - discount) times the range of V' - V
+  lowerOffset = discount * deltaRange[0] / (1 - discount);
+  upperOffset = discount * deltaRange[1] / (1 - discount);
+};
+
+double ValueIteration::parallelSweep(SparseTransitionModel& transMatrix, const std::vector<QValue>& prevValues, std::vector<QValue>& currValues, double* deltaRange)
+{
+  long n = (numThreads < numStates)? numThreads : numStates;
+  vector<SweepTask> tasks(n);
+  vector<pthread_t> threads(n);
+  long chunk = numStates / n, remainder = numStates % n, begin = 0;
+
+  for (long t = 0; t < n; t++){
+    tasks[t].solver = this;
+    tasks[t].transMatrix = &transMatrix;
+    tasks[t].prevValues = &prevValues;
+    tasks[t].currValues = &currValues;
+    tasks[t].begin = begin;
+    tasks[t].end = begin + chunk + ((t < remainder)? 1 : 0);
+    tasks[t].maxChange = 0;
+    begin = tasks[t].end;
+  }
+  // thread 0's range is handled by the calling thread
+  for (long t = 1; t < n; t++){
+    if (pthread_create(&threads[t], NULL, sweepWorker, &tasks[t]) != 0){
+      cerr << "Fail to create sweep thread " << t << "\n";
+      exit(EXIT_FAILURE);
+    }
+  }
+  sweepWorker(&tasks[0]);
+  for (long t = 1; t < n; t++)
+    pthread_join(threads[t], NULL);
+
+  // reduce in thread order so the residual does not depend on scheduling
+  double maxChange = 0;
+  for (long t = 0; t < n; t++){
+    if (tasks[t].maxChange > maxChange)
+      maxChange = tasks[t].maxChange;
+    if (tasks[t].deltaRange[0] < deltaRange[0] || t == 0)
+      deltaRange[0] = tasks[t].deltaRange[0];
+    if (tasks[t].deltaRange[1] > deltaRange[1] || t == 0)
+      deltaRange[1] = tasks[t].deltaRange[1];
+  }
+  return maxChange;
+};
+
+/**
+   How often, in ms, a process waiting at the sweep barrier checks that its peers are alive.
+*/
+const long BarrierPollMs = 100;
+
+/**
+   Kills and reaps the sweep workers that are still running.
+*/
+static void killWorkers(vector<pid_t>& workers)
+{
+  for (unsigned p = 0; p < workers.size(); p++){
+    if (workers[p] <= 0)
+      continue;
+    kill(workers[p], SIGKILL);
+    waitpid(workers[p], 0, 0);
+    workers[p] = 0;
+  }
+};
+
+/**
+   @return false, after reaping it, if a sweep worker has exited
+*/
+static bool workersAlive(vector<pid_t>& workers)
+{
+  for (unsigned p = 0; p < workers.size(); p++){
+    if (workers[p] <= 0)
+      continue;
+    int status;
+    if (waitpid(workers[p], &status, WNOHANG) != 0){
+      cerr << "Sweep worker " << p << " failed\n";
+      workers[p] = 0;
+      return false;
+    }
+  }
+  return true;
+};
+
+/**
+   Barrier of the sweep processes, in shared memory. Unlike pthread_barrier_t its waits
+   time out, so the processes are not left waiting for good on a worker that died:
+   the mutex is robust, and the parent polls its workers while it waits.
+*/
+struct SweepBarrier
+{
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  long numProcs, arrived, generation;
+  bool broken;
+
+  void init(long n)
+  {
+    pthread_mutexattr_t mutexAttr;
+    pthread_mutexattr_init(&mutexAttr);
+    pthread_mutexattr_setpshared(&mutexAttr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&mutexAttr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&mutex, &mutexAttr);
+    pthread_mutexattr_destroy(&mutexAttr);
+    pthread_condattr_t condAttr;
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setpshared(&condAttr, PTHREAD_PROCESS_SHARED);
+    pthread_cond_init(&cond, &condAttr);
+    pthread_condattr_destroy(&condAttr);
+    numProcs = n;
+    arrived = 0;
+    generation = 0;
+    broken = false;
+  };
+
+  void destroy()
+  {
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&mutex);
+  };
+
+  /**
+     Waits until all numProcs processes have arrived. \a workers is given by the parent,
+     which checks them every BarrierPollMs.
+     @return false if a process died, in which case the barrier stays broken
+  */
+  bool wait(vector<pid_t>* workers)
+  {
+    // a process killed while holding the mutex leaves it to the next one, marked dead
+    if (pthread_mutex_lock(&mutex) == EOWNERDEAD){
+      pthread_mutex_consistent(&mutex);
+      broken = true;
+    }
+    long gen = generation;
+    if (++arrived == numProcs){
+      arrived = 0;
+      generation++;
+      pthread_cond_broadcast(&cond);
+    }
+    while (!broken && generation == gen){
+      struct timespec deadline;
+      clock_gettime(CLOCK_REALTIME, &deadline);
+      deadline.tv_nsec += BarrierPollMs * 1000000;
+      deadline.tv_sec += deadline.tv_nsec / 1000000000;
+      deadline.tv_nsec %= 1000000000;
+      int rc = pthread_cond_timedwait(&cond, &mutex, &deadline);
+      if (rc == EOWNERDEAD){
+        pthread_mutex_consistent(&mutex);
+        broken = true;
+      }
+      else if (rc == ETIMEDOUT && workers && !workersAlive(*workers))
+        broken = true;
+    }
+    bool passed = !broken;
+    if (broken)
+      pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&mutex);
+    return passed;
+  };
+};
+
+/**
+   Offsets of the arrays inside the shared memory segment used by processSweeps.
+*/
+struct SharedSweepLayout
+{
+  size_t barrier, residuals, evals, values, actions, qValues, bounds, total;
+
+  SharedSweepLayout(long numStates, long numActions, long numProcs, bool withQ, bool withBounds)
+  {
+    total = 0;
+    barrier = place(sizeof(SweepBarrier));
+    residuals = place(2 * 2 * numProcs * sizeof(double));
+    evals = place(numProcs * sizeof(long));
+    values = place(2 * numStates * sizeof(QValue));
+    actions = place(numStates * sizeof(int));
+    qValues = place(withQ? numStates * numActions * sizeof(QValue) : 0);
+    bounds = place(withBounds? 4 * numStates * sizeof(QValue) : 0);
+  };
+
+  size_t place(size_t bytes)
+  {
+    size_t offset = total;
+    // keep every array on its own cache line
+    total += (bytes + 63) / 64 * 64;
+    return offset;
+  };
+};
+
+void ValueIteration::processSweeps(SparseTransitionModel& transMatrix, const std::vector<QValue>& startValues, double targetPrecision)
+{
+  long n = (numProcesses < numStates)? numProcesses : numStates;
+  SharedSweepLayout layout(numStates, numActions, n, qOutput != 0, eliminate);
+
+  ostringstream name;
+  name << "/capir-vi-" << getpid();
+  int fd = shm_open(name.str().c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  if (fd < 0){
+    cerr << "Fail to create shared memory " << name.str() << "\n";
+    exit(EXIT_FAILURE);
+  }
+  // the segment stays alive through the mapping, which the workers inherit
+  shm_unlink(name.str().c_str());
+  if (ftruncate(fd, layout.total) != 0){
+    cerr << "Fail to size shared memory " << name.str() << "\n";
+    exit(EXIT_FAILURE);
+  }
+  char* shared = (char*) mmap(0, layout.total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (shared == MAP_FAILED){
+    cerr << "Fail to map shared memory " << name.str() << "\n";
+    exit(EXIT_FAILURE);
+  }
+
+  SweepBarrier* barrier = (SweepBarrier*) (shared + layout.barrier);
+  double* residuals = (double*) (shared + layout.residuals);
+  long* evals = (long*) (shared + layout.evals);
+  QValue* buffers[2] = {(QValue*) (shared + layout.values), (QValue*) (shared + layout.values) + numStates};
+  int* sharedActions = (int*) (shared + layout.actions);
+  QValue* sharedQ = (QValue*) (shared + layout.qValues);
+
+  barrier->init(n);
+  if (eliminate){
+    // the bounds move to shared memory, like the values
+    QValue* sharedBounds = (QValue*) (shared + layout.bounds);
+    copy(boundStore.begin(), boundStore.end(), sharedBounds);
+    vector<QValue>().swap(boundStore);
+    bounds[0] = sharedBounds;
+    bounds[1] = sharedBounds + 2 * numStates;
+  }
+
+  for (long i = 0; i < numStates; i++)
+    buffers[0][i] = buffers[1][i] = startValues[i];
+  for (long w = 0; w < n; w++)
+    evals[w] = 0;
+
+  vector<long> begins(n + 1, 0);
+  long chunk = numStates / n, remainder = numStates % n;
+  for (long w = 0; w < n; w++)
+    begins[w + 1] = begins[w] + chunk + ((w < remainder)? 1 : 0);
+
+  // buffered output would otherwise be flushed once per worker
+  cout.flush();
+  cerr.flush();
+  vector<pid_t> workers(n, 0);
+  pid_t parent = getpid();
+  long w = 0;
+  for (long p = 1; p < n; p++){
+    pid_t pid = fork();
+    if (pid < 0){
+      // the workers already started would wait at the barrier for good
+      cerr << "Fail to fork sweep worker " << p << "\n";
+      killWorkers(workers);
+      exit(EXIT_FAILURE);
+    }
+    if (pid == 0){
+      // die with the parent rather than wait for it at the barrier
+      prctl(PR_SET_PDEATHSIG, SIGKILL);
+      if (getppid() != parent)
+        _exit(EXIT_FAILURE);
+      w = p;
+      break;
+    }
+    workers[p] = pid;
+  }
+
+  // Every worker runs the same loop over its own range. The residuals, the smallest
+  // and largest change of each range, are double buffered by sweep parity, so a worker
+  // can only overwrite a slot after every worker has passed the next barrier and is
+  // done reading it.
+  long begin = begins[w], end = begins[w + 1];
+  long currIndex = 0, nextIndex = 1, sweeps = 0;
+  double currChange = FLT_MAX;
+  while (currChange > targetPrecision){
+    if (eliminate){
+      for (long i = begin; i < end; i++)
+        evals[w] += numActive[i];
+    }
+    else
+      evals[w] += (end - begin) * numActions;
+
+    double* slot = residuals + (sweeps % 2) * 2 * n;
+    sweepRange(transMatrix, buffers[nextIndex], buffers[currIndex], begin, end, slot + 2 * w);
+    if (!barrier->wait((w == 0)? &workers : 0)){
+      if (w != 0)
+        _exit(EXIT_FAILURE);
+      killWorkers(workers);
+      exit(EXIT_FAILURE);
+    }
+
+    double deltaRange[2] = {slot[0], slot[1]};
+    for (long p = 1; p < n; p++){
+      if (slot[2 * p] < deltaRange[0])
+        deltaRange[0] = slot[2 * p];
+      if (slot[2 * p + 1] > deltaRange[1])
+        deltaRange[1] = slot[2 * p + 1];
+    }
+    currChange = (deltaRange[1] > -deltaRange[0])? deltaRange[1] : -deltaRange[0];
+    sweeps++;
+    if (eliminate)
+      nextBounds(deltaRange);
+    currIndex = nextIndex;
+    nextIndex = (nextIndex + 1) % 2;
+  }
+
+  // hand the range's policy and Q rows back through shared memory
+  for (long i = begin; i < end; i++){
+    sharedActions[i] = actions[i];
+    if (qOutput)
+      for (long j = 0; j < numActions; j++)
+        sharedQ[i * numActions + j] = (*qOutput)[i][j];
+  }
+  if (w != 0)
+    _exit(EXIT_SUCCESS);
+
+  for (long p = 1; p < n; p++){
+    int status;
+    if (waitpid(workers[p], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS){
+      cerr << "Sweep worker " << p << " failed\n";
+      workers[p] = 0;
+      killWorkers(workers);
+      exit(EXIT_FAILURE);
+    }
+    workers[p] = 0;
+  }
+
+  numSweeps = sweeps;
+  numBackups = sweeps * numStates;
+  for (long p = 0; p < n; p++)
+    numActionEvals += evals[p];
+  for (long i = 0; i < numStates; i++){
+    values[i] = buffers[nextIndex][i];
+    actions[i] = sharedActions[i];
+    if (qOutput)
+      for (long j = 0; j < numActions; j++)
+        (*qOutput)[i][j] = sharedQ[i * numActions + j];
+  }
+
+  barrier->destroy();
+  munmap(shared, layout.total);
+};
+
+void ValueIteration::computeReverseBFSOrder(SparseTransitionModel& transMatrix)
+{
+  // predecessor lists in compressed form: predecessors of s are preds[predStart[s]..predStart[s+1])
+  vector<long> predStart(numStates + 1, 0);
+  for (long k = 0; k < transMatrix.getNumEntries(); k++)
+    predStart[transMatrix.nextStates[k] + 1]++;
+  for (long s = 0; s < numStates; s++)
+    predStart[s + 1] += predStart[s];
+
+  vector<long> preds(predStart[numStates]);
+  vector<long> fill(predStart.begin(), predStart.end() - 1);
+  for (long i = 0; i < numStates; i++)
+    for (long k = transMatrix.rowBegin(i, 0); k < transMatrix.rowEnd(i, numActions - 1); k++)
+      preds[fill[transMatrix.nextStates[k]]++] = i;
+
+  vector<bool> visited(numStates, false);
+  sweepOrder.clear();
+  sweepOrder.reserve(numStates);
+  if (orderRoot >= 0 && orderRoot < numStates){
+    visited[orderRoot] = true;
+    sweepOrder.push_back(orderRoot);
+  }
+  for (long head = 0; head < (long) sweepOrder.size(); head++){
+    long s = sweepOrder[head];
+    for (long p = predStart[s]; p < predStart[s + 1]; p++){
+      if (!visited[preds[p]]){
+        visited[preds[p]] = true;
+        sweepOrder.push_back(preds[p]);
+      }
+    }
+  }
+  for (long s = 0; s < numStates; s++){
+    if (!visited[s])
+      sweepOrder.push_back(s);
+  }
+};
+
+void ValueIteration::computeComponents(SparseTransitionModel& transMatrix, std::vector<long>& componentStart)
+{
+  vector<long> index(numStates, -1), lowLink(numStates, 0), edgePos(numStates, 0);
+  vector<bool> onStack(numStates, false);
+  vector<long> tarjanStack, callStack;
+  long counter = 0;
+
+  sweepOrder.clear();
+  sweepOrder.reserve(numStates);
+  componentStart.assign(1, 0);
+
+  for (long root = 0; root < numStates; root++){
+    if (index[root] >= 0)
+      continue;
+    index[root] = lowLink[root] = counter++;
+    edgePos[root] = transMatrix.rowBegin(root, 0);
+    tarjanStack.push_back(root);
+    onStack[root] = true;
+    callStack.push_back(root);
+
+    while (!callStack.empty()){
+      long v = callStack.back();
+      if (edgePos[v] < transMatrix.rowEnd(v, numActions - 1)){
+        long w = transMatrix.nextStates[edgePos[v]++];
+        if (index[w] < 0){
+          index[w] = lowLink[w] = counter++;
+          edgePos[w] = transMatrix.rowBegin(w, 0);
+          tarjanStack.push_back(w);
+          onStack[w] = true;
+          callStack.push_back(w);
+        }
+        else if (onStack[w] && index[w] < lowLink[v])
+          lowLink[v] = index[w];
+        continue;
+      }
+
+      // all successors of v explored
+      callStack.pop_back();
+      if (lowLink[v] == index[v]){
+        long w;
+        do {
+          w = tarjanStack.back();
+          tarjanStack.pop_back();
+          onStack[w] = false;
+          sweepOrder.push_back(w);
+        } while (w != v);
+        componentStart.push_back((long) sweepOrder.size());
+      }
+      if (!callStack.empty() && lowLink[v] < lowLink[callStack.back()])
+        lowLink[callStack.back()] = lowLink[v];
+    }
+  }
+};
+
+std::vector<QValue> ValueIteration::startValues()
+{
+  if ((long) initialValues.size() == numStates)
+    return initialValues;
+  return vector<QValue>(numStates, 0);
+};
+
+void ValueIteration::doValueIteration(SparseTransitionModel& transMatrix, double targetPrecision, long displayInterval)
 {
   // record time
   time_t start, curr;
@@ -35,19 +642,87 @@ void ValueIteration::doValueIteration(std::vector<std::vector<double> >& rewardM
   time(&start);
   time(&curr);
 
-  vector<vector<double> > tempValues;
+  double currChange = FLT_MAX; 
+  numSweeps = 0;
+  numBackups = 0;
+  numActionEvals = 0;
+
+  if (sweep == topologicalSweep){
+    // Successor components are final by the time a component is solved, so each
+    // component only needs in-place sweeps until its own values settle.
+    vector<long> componentStart;
+    values = startValues();
+    computeComponents(transMatrix, componentStart);
+
+    for (long c = 0; c + 1 < (long) componentStart.size(); c++){
+      long begin = componentStart[c], end = componentStart[c + 1];
+      bool selfLoop = false;
+      if (end - begin == 1){
+        long s = sweepOrder[begin];
+        for (long k = transMatrix.rowBegin(s, 0); k < transMatrix.rowEnd(s, numActions - 1) && !selfLoop; k++)
+          selfLoop = (transMatrix.nextStates[k] == s);
+      }
+      long componentSweeps = 0;
+      do {
+        currChange = sweepRange(transMatrix, &values[0], &values[0], begin, end);
+        numBackups += end - begin;
+        numActionEvals += (end - begin) * numActions;
+        componentSweeps++;
+      } while ((end - begin > 1 || selfLoop) && currChange > targetPrecision);
+      if (componentSweeps > numSweeps)
+        numSweeps = componentSweeps;
+    }
+    sweepOrder.clear();
+    return;
+  }
+
+  if (sweep == gaussSeidelSweep){
+    // Single buffer: values are overwritten as soon as they are backed up
+    values = startValues();
+    sweepOrder.clear();
+    if (stateOrder == reverseBFSOrder)
+      computeReverseBFSOrder(transMatrix);
+
+    while (currChange > targetPrecision){
+      currChange = sweepRange(transMatrix, &values[0], &values[0], 0, numStates);
+      numSweeps++;
+      numBackups += numStates;
+      numActionEvals += numStates * numActions;
+    }
+    sweepOrder.clear();
+    return;
+  }
+
+  vector<vector<QValue> > tempValues;
 
   // What are tempValues?
   // It's the temp values to compare changes
-  // Note: Two of them initialized to all 0.
+  // Note: Two of them initialized to all 0, or to the warm start values.
   tempValues.resize(2);
   for (long i=0; i< 2; i++){
-    tempValues[i].resize(numStates,0);
+    tempValues[i] = startValues();
   }
 
-  double currChange = FLT_MAX; 
   long currIndex = 0, nextIndex = 1;
 
+  if (eliminate){
+    if (numActions > 255){
+      cerr << "Action elimination supports at most 255 actions\n";
+      exit(EXIT_FAILURE);
+    }
+    activeActs.resize(numStates * numActions);
+    numActive.assign(numStates, (unsigned char) numActions);
+    for (long i = 0; i < numStates; i++)
+      for (long j = 0; j < numActions; j++)
+        activeActs[i * numActions + j] = (unsigned char) j;
+    initBounds(transMatrix);
+  }
+
+  if (numProcesses > 1){
+    processSweeps(transMatrix, tempValues[nextIndex], targetPrecision);
+    return;
+  }
+
   while (currChange > targetPrecision){
     // for display
     double temp = difftime(curr,start);
@@ -56,36 +731,22 @@ void ValueIteration::doValueIteration(std::vector<std::vector<double> >& rewardM
       //cout << "time: " << temp << " Diff: " << currChange << "\n";
     }
  
-    // For each state, look for the best value that goes with best action in that state
-    for (long i=0; i< numStates; i++){
-      double bestValue = -FLT_MAX;
-      long bestAction = 0;
-      
-      for (long j = 0; j < numActions; j++){
-        // Compute discounted reward
-        double currValue = rewardMatrix[i][j];
-        for (long k = 0; k < transMatrix[i][j].size(); k++){
-          long nextState = transMatrix[i][j][k].first;
-          double prob = transMatrix[i][j][k].second;
-          currValue +=  discount * prob * tempValues[nextIndex][nextState];
-        }
-        
-        // Seach for best discounted rewards among all actions in this state
-        if (currValue > bestValue){
-          bestValue = currValue;
-          bestAction = j;
-        }
-      }
-      
-      // For this iteration tempValues store the best value of the state thus far
-      tempValues[currIndex][i] = bestValue;
-      actions[i] = bestAction;
-    }
-    currChange = 0;
-    for (long i = 0; i < numStates; i++){
-      if (fabs(tempValues[currIndex][i]- tempValues[nextIndex][i])> currChange)
-        currChange = fabs(tempValues[currIndex][i]- tempValues[nextIndex][i]);
+    if (eliminate){
+      for (long i = 0; i < numStates; i++)
+        numActionEvals += numActive[i];
     }
+    else
+      numActionEvals += numStates * numActions;
+
+    double deltaRange[2];
+    if (numThreads > 1)
+      currChange = parallelSweep(transMatrix, tempValues[nextIndex], tempValues[currIndex], deltaRange);
+    else
+      currChange = sweepRange(transMatrix, &tempValues[nextIndex][0], &tempValues[currIndex][0], 0, numStates, deltaRange);
+    numSweeps++;
+    numBackups += numStates;
+    if (eliminate)
+      nextBounds(deltaRange);
 
     currIndex = nextIndex;
     nextIndex = (nextIndex + 1) % 2;
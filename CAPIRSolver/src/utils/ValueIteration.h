@@ -16,6 +16,8 @@
 
 #include <vector>
 #include <string>
+#include "SparseTransitionModel.h"
+#include "BellmanBackup.h"
 
 /**
    @class ValueIteration
@@ -27,14 +29,97 @@
 class ValueIteration
 {
  public:
-  ValueIteration(long numStates, long numActions, double discount): numStates(numStates), numActions(numActions), discount(discount) {};
+    /**
+       jacobiSweep backs up every state from the previous sweep's values (two buffers).
+       gaussSeidelSweep updates values in place, so later states in the sweep already
+       see the values refreshed earlier in the same sweep.
+       topologicalSweep splits the states into strongly connected components and
+       solves them in reverse topological order, each to convergence and only once.
+    */
+    enum sweepType {jacobiSweep, gaussSeidelSweep, topologicalSweep};
+
+    /**
+       Order in which a Gauss-Seidel sweep visits the states.
+       reverseBFSOrder starts from the root state (the terminal state) and walks
+       the transition graph backwards, so states close to the absorbing state are
+       backed up before the states that depend on them.
+    */
+    enum stateOrderType {naturalOrder, reverseBFSOrder};
+
+  ValueIteration(long numStates, long numActions, double discount): numSweeps(0), numBackups(0), numActionEvals(0), numStates(numStates), numActions(numActions), discount(discount), numThreads(1), numProcesses(1), sweep(jacobiSweep), stateOrder(naturalOrder), orderRoot(0), backupKernel(BellmanBackup::genericBackup), qOutput(0), eliminate(false), boundRead(0) {};
     
-    ValueIteration(long numActions, double discount): numActions(numActions), discount(discount) {};
+    ValueIteration(long numActions, double discount): numSweeps(0), numBackups(0), numActionEvals(0), numActions(numActions), discount(discount), numThreads(1), numProcesses(1), sweep(jacobiSweep), stateOrder(naturalOrder), orderRoot(0), backupKernel(BellmanBackup::genericBackup), qOutput(0), eliminate(false), boundRead(0) {};
 
-    void doValueIteration(std::vector<std::vector<double> >& rewardMatrix, std::vector<std::vector<std::vector<std::pair<long,double> > > >& transMatrix, double targetPrecision, long displayInterval);
+    /**
+       Number of threads each sweep is split across. Every thread backs up a
+       contiguous range of states, so the result is identical to the serial sweep.
+    */
+    void setNumThreads(long n) { numThreads = (n < 1)? 1 : n; };
+
+    /**
+       Number of forked worker processes for Jacobi sweeps. The value vectors live in
+       POSIX shared memory, every process backs up a contiguous range of states and
+       the processes meet at a barrier after each sweep, so the result is identical
+       to the serial sweep. If a process dies, the others are killed and the solver
+       exits instead of waiting for it. Takes precedence over setNumThreads.
+    */
+    void setNumProcesses(long n) { numProcesses = (n < 1)? 1 : n; };
+
+    /**
+       Selects the sweep type. \a order and \a root only matter for Gauss-Seidel;
+       Gauss-Seidel and topological sweeps always run on one thread.
+    */
+    void setSweepType(sweepType s, stateOrderType order = naturalOrder, long root = 0) { sweep = s; stateOrder = order; orderRoot = root; };
+
+    /**
+       Kernel used for every state backup, see BellmanBackup::selectKernel.
+    */
+    void setBackupKernel(BellmanBackupKernel kernel) { backupKernel = kernel; };
+
+    /**
+       Start the next doValueIteration from \a init instead of all zeros (warm start).
+       Ignored if the size does not match.
+    */
+    void setInitialValues(const std::vector<QValue>& init) { initialValues = init; };
+
+    /**
+       Turns on bound-based action elimination for Jacobi sweeps. \a vMin and \a vMax
+       bound the optimal value of every state and seed an upper and a lower bound per
+       state. Each sweep backs the bounds up along with the values and tightens them
+       with MacQueen's bounds, V + discount / (1 - discount) times the smallest and the
+       largest change of the last sweep. An action whose upper bound falls below the best
+       action's lower bound is dropped from that state's active list for good. Ignored
+       by Gauss-Seidel and topological sweeps.
+    */
+    void setActionElimination(bool on, double vMin, double vMax) { eliminate = on; valueMin = vMin; valueMax = vMax; };
+
+    /**
+       Every sweep also writes the value of each action into \a qFn (numStates rows of
+       numActions, allocated by the caller), so when the solve stops \a qFn holds the Q
+       function the final values are the max of, and no separate pass over the model is
+       needed. Not available with action elimination, which skips dropped actions.
+    */
+    void setQOutput(std::vector<std::vector<QValue> >* qFn) { qOutput = qFn; };
+
+    void doValueIteration(SparseTransitionModel& transMatrix, double targetPrecision, long displayInterval);
     
-    std::vector<double> values;
+    std::vector<QValue> values;
     std::vector<int> actions;
+
+    /**
+       Number of sweeps performed by the last call to doValueIteration.
+    */
+    long numSweeps;
+
+    /**
+       Number of single-state Bellman backups performed by the last call to doValueIteration.
+    */
+    long numBackups;
+
+    /**
+       Number of (state, action) values computed by the last call to doValueIteration.
+    */
+    long numActionEvals;
     
     /** 
       Write out the policy \a filename
@@ -50,6 +135,98 @@ class ValueIteration
     long numStates;
     long numActions;
     double discount;
+    long numThreads;
+    long numProcesses;
+    sweepType sweep;
+    stateOrderType stateOrder;
+    long orderRoot;
+    BellmanBackupKernel backupKernel;
+    std::vector<QValue> initialValues;
+
+    std::vector<std::vector<QValue> >* qOutput;
+
+    bool eliminate;
+    double valueMin, valueMax;
+    /**
+       Per-state bounds on V*, upper and lower of state s at [2 * s] and [2 * s + 1].
+       Double buffered like the values: the current sweep reads bounds[boundRead] and
+       writes the other one. They point into boundStore, or into the shared segment of
+       processSweeps.
+    */
+    std::vector<QValue> boundStore;
+    QValue* bounds[2];
+    int boundRead;
+    /**
+       MacQueen offsets for the values the current sweep reads: V* - V lies within
+       [lowerOffset, upperOffset] for every state.
+    */
+    double lowerOffset, upperOffset;
+    /**
+       Active actions of state s, in increasing order: activeActs[s * numActions .. + numActive[s]).
+    */
+    std::vector<unsigned char> activeActs;
+    std::vector<unsigned char> numActive;
+
+    /**
+       Backs up state \a i and its bounds over its active actions only and drops the
+       dominated ones.
+    */
+    double eliminationBackup(const QValue* reward, SparseTransitionModel& transMatrix, long i, const QValue* values, long& bestAction);
+
+    /**
+       Seeds the bounds in boundStore with valueMin and valueMax, tightened where the
+       model allows: absorbing states get their exact value, and if every reward ends
+       the run, V* lies within the rewards.
+    */
+    void initBounds(SparseTransitionModel& transMatrix);
+
+    /**
+       Switches to the bounds the last sweep wrote and takes the MacQueen offsets from
+       its smallest and largest change, \a deltaRange[0] and \a deltaRange[1].
+    */
+    void nextBounds(const double* deltaRange);
+
+    /**
+       @return initialValues if set for numStates states, otherwise all zeros
+    */
+    std::vector<QValue> startValues();
+
+    /**
+       States in the order a Gauss-Seidel sweep visits them. Empty means 0..numStates-1.
+    */
+    std::vector<long> sweepOrder;
+
+    /**
+       Fills sweepOrder by a breadth-first search from orderRoot over the reversed
+       transition graph. States that cannot reach orderRoot are appended in index order.
+    */
+    void computeReverseBFSOrder(SparseTransitionModel& transMatrix);
+
+    /**
+       Fills sweepOrder with the strongly connected components of the transition
+       graph (Tarjan's algorithm, iterative). Components come out in reverse
+       topological order, i.e. every component appears after all components it
+       can reach. Component c is sweepOrder[componentStart[c] .. componentStart[c+1]).
+    */
+    void computeComponents(SparseTransitionModel& transMatrix, std::vector<long>& componentStart);
+
+    /**
+       Backs up states in [\a begin, \a end) of the sweep order from \a prevValues into
+       \a currValues. The two may be the same vector for an in-place sweep. If given,
+       \a deltaRange receives the smallest and the largest signed change.
+       @return max absolute change over the range
+    */
+    double sweepRange(SparseTransitionModel& transMatrix, const QValue* prevValues, QValue* currValues, long begin, long end, double* deltaRange = 0);
+
+    double parallelSweep(SparseTransitionModel& transMatrix, const std::vector<QValue>& prevValues, std::vector<QValue>& currValues, double* deltaRange);
+
+    static void* sweepWorker(void* arg);
+
+    /**
+       Jacobi sweeps split across numProcesses forked workers, starting from \a startValues.
+       Fills values, actions and qOutput like the single-process loop.
+    */
+    void processSweeps(SparseTransitionModel& transMatrix, const std::vector<QValue>& startValues, double targetPrecision);
 
 };
 